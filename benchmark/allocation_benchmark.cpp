@@ -0,0 +1,89 @@
+#include <simple_xdmf.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+// count every heap allocation of the process
+static std::size_t allocation_count = 0;
+
+// every form is replaced, so that each pointer is released by std::free() from std::malloc()
+static void* countedAllocate(std::size_t size) {
+    ++allocation_count;
+    if (void* ptr = std::malloc(size != 0 ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size) {
+    return countedAllocate(size);
+}
+
+void* operator new[](std::size_t size) {
+    return countedAllocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void buildDocument(SimpleXdmf& gen, const int grid_count, const std::vector<float>& values) {
+    gen.beginDomain("Domain1");
+    for(int n = 0; n < grid_count; ++n) {
+        gen.beginGrid();
+            gen.beginStructuredTopology("", "2DCoRectMesh");
+            gen.setNumberOfElements(4, 4);
+            gen.endStructuredTopology();
+
+            gen.beginAttribute("", "Scalar");
+            gen.setCenter("Node");
+                gen.beginDataItem();
+                    gen.setDimensions(4, 4);
+                    gen.setFormat("XML");
+                    gen.addVector(values);
+                gen.endDataItem();
+            gen.endAttribute();
+        gen.endGrid();
+    }
+    gen.endDomain();
+    gen.endXdmf();
+}
+
+int main() {
+    const int grid_count = 100000;
+    std::vector<float> values(16, 0.5f);
+
+    SimpleXdmf gen;
+
+    // the first document grows the buffers
+    buildDocument(gen, grid_count, values);
+    std::cout << "document size        : " << gen.getRawString().size() << " bytes" << std::endl;
+
+    // the second document reuses them
+    gen.reset();
+    const auto allocations_before = allocation_count;
+    const auto start = std::chrono::steady_clock::now();
+
+    buildDocument(gen, grid_count, values);
+
+    const auto end = std::chrono::steady_clock::now();
+    const auto allocations = allocation_count - allocations_before;
+    const double seconds = std::chrono::duration<double>(end - start).count();
+
+    std::cout << "grids                : " << grid_count << std::endl;
+    std::cout << "allocations          : " << allocations << std::endl;
+    std::cout << "allocations per grid : " << static_cast<double>(allocations) / grid_count << std::endl;
+    std::cout << "time per grid        : " << seconds / grid_count * 1e9 << " ns" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include <simple_xdmf.hpp>
+#include <chrono>
+#include <cstdlib>
+
+// writes an AMR hierarchy block by block, and by addAMRHierarchy()
+int main(int argc, char** argv) {
+    const std::size_t block_count = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 50000;
+    const std::size_t n = 8; // cells per block along each axis
+
+    std::vector<SimpleXdmf::AMRBlock> blocks(block_count);
+    for(std::size_t i = 0; i < block_count; ++i) {
+        blocks[i].level = static_cast<unsigned int>(i % 4);
+        const double spacing = 1.0 / static_cast<double>(1 << blocks[i].level);
+        blocks[i].spacing = {{spacing, spacing, spacing}};
+        blocks[i].origin = {{static_cast<double>(i) * spacing * n, 0.0, 0.0}};
+        blocks[i].extents = {{n + 1, n + 1, n + 1}};
+    }
+
+    std::vector<double> values(n * n * n, 1.0);
+    SimpleXdmf::AMRField<double> density;
+    density.name = "Density";
+    density.values.assign(block_count, values.data());
+
+    {
+        SimpleXdmf gen;
+        gen.setHeavyDataFile("amr_benchmark.bin");
+        const auto start = std::chrono::steady_clock::now();
+
+        gen.beginDomain();
+            gen.beginGrid("AMR", "Tree");
+            for(unsigned int level = 0; level < 4; ++level) {
+                gen.beginGrid("Level" + std::to_string(level), "Collection");
+                for(std::size_t i = level; i < block_count; i += 4) {
+                    const auto& b = blocks[i];
+                    gen.begin3DStructuredGrid("Block" + std::to_string(i), "3DCoRectMesh", b.extents[0], b.extents[1], b.extents[2]);
+                        gen.add3DGeometryOrigin("", b.origin[0], b.origin[1], b.origin[2], b.spacing[0], b.spacing[1], b.spacing[2]);
+                        gen.beginAttribute("Density");
+                            gen.setCenter("Cell");
+                            gen.beginDataItem();
+                                gen.setDimensions(n, n, n);
+                                gen.setFormat("Binary");
+                                gen.addVector(values);
+                            gen.endDataItem();
+                        gen.endAttribute();
+                    gen.end3DStructuredGrid();
+                }
+                gen.endGrid();
+            }
+            gen.endGrid();
+        gen.endDomain();
+        gen.generate("amr_benchmark.xmf");
+
+        const auto end = std::chrono::steady_clock::now();
+        std::cout << "block by block: " << block_count << " blocks in " << std::chrono::duration<double>(end - start).count() << " s" << std::endl;
+    }
+
+    {
+        SimpleXdmf gen;
+        gen.setHeavyDataFile("amr_benchmark.bin");
+        const auto start = std::chrono::steady_clock::now();
+
+        gen.beginDomain();
+            gen.addAMRHierarchy<double>("AMR", blocks, {density});
+        gen.endDomain();
+        gen.generate("amr_benchmark.xmf");
+
+        const auto end = std::chrono::steady_clock::now();
+        std::cout << "addAMRHierarchy(): " << block_count << " blocks in " << std::chrono::duration<double>(end - start).count() << " s" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,55 @@
+#include <simple_xdmf.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+// computes and writes grid_count Attributes, comparing the std::ofstream output with asynchronous output
+// define USE_IO_URING to use io_uring on Linux
+double run(const std::size_t grid_size, const std::size_t grid_count, const char* heavy_data_file, const int mode) {
+    SimpleXdmf gen;
+    gen.setHeavyDataFile(heavy_data_file);
+    if (mode > 0) gen.setAsyncHeavyData(true, 1 << 22, 8, mode == 2);
+
+    std::vector<double> values(grid_size);
+    const auto start = std::chrono::steady_clock::now();
+
+    gen.beginDomain();
+        gen.beginGrid("Grids", "Collection");
+        for(std::size_t g = 0; g < grid_count; ++g) {
+            for(std::size_t i = 0; i < grid_size; ++i) {
+                values[i] = std::sin(static_cast<double>(g + i));
+            }
+
+            gen.beginGrid("Grid" + std::to_string(g));
+                gen.beginAttribute("Values");
+                    gen.beginDataItem();
+                        gen.setDimensions(grid_size);
+                        gen.setFormat("Binary");
+                        gen.addVector(values);
+                    gen.endDataItem();
+                gen.endAttribute();
+            gen.endGrid();
+        }
+        gen.endGrid();
+    gen.endDomain();
+    gen.generate("async_heavy_data_benchmark.xmf");
+
+    const auto end = std::chrono::steady_clock::now();
+    if (mode > 0) std::cout << "(" << gen.getAsyncHeavyDataEngine() << ") ";
+    return std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char** argv) {
+    const std::size_t grid_size = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : std::size_t(1) << 22;
+    const std::size_t grid_count = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 32;
+    const char* heavy_data_file = (argc > 3) ? argv[3] : "async_heavy_data_benchmark.bin";
+    const double bytes = static_cast<double>(grid_size * grid_count * sizeof(double));
+
+    const char* names[] = {"std::ofstream", "async", "async + O_DIRECT"};
+    for(int mode = 0; mode < 3; ++mode) {
+        const double seconds = run(grid_size, grid_count, heavy_data_file, mode);
+        std::cout << names[mode] << ": " << bytes / 1e9 << " GB in " << seconds << " s, " << bytes / seconds / 1e9 << " GB/s" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include <simple_xdmf.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+
+struct Cell {
+    double depth;
+    double velocity_x;
+    double velocity_y;
+    double bed;
+    double roughness;
+    double concentration;
+};
+
+// writes the fields of an array of cells field by field and with addAttributes()
+int main(int argc, char** argv) {
+    const std::size_t size = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 4000000;
+
+    std::vector<Cell> cells(size);
+    for(std::size_t i = 0; i < size; ++i) {
+        const double x = 0.001 * static_cast<double>(i);
+        cells[i] = Cell{x, 2.0 * x, 3.0 * x, -x, 0.5 * x, 0.25 * x};
+    }
+
+    const std::vector<std::pair<std::string, std::size_t>> names = {
+        {"Depth", offsetof(Cell, depth)}, {"VelocityX", offsetof(Cell, velocity_x)}, {"VelocityY", offsetof(Cell, velocity_y)},
+        {"Bed", offsetof(Cell, bed)}, {"Roughness", offsetof(Cell, roughness)}, {"Concentration", offsetof(Cell, concentration)}};
+
+    for(const bool batched : {false, true}) {
+        SimpleXdmf gen;
+        gen.setHeavyDataFile("batched_attributes_benchmark.bin");
+        const auto start = std::chrono::steady_clock::now();
+
+        gen.beginDomain();
+            gen.beginGrid("Grid");
+            if (batched) {
+                std::vector<SimpleXdmf::AttributeField<double>> fields(names.size());
+                for(std::size_t f = 0; f < names.size(); ++f) {
+                    fields[f].name = names[f].first;
+                    fields[f].values = reinterpret_cast<const double*>(reinterpret_cast<const char*>(cells.data()) + names[f].second);
+                    fields[f].stride = sizeof(Cell);
+                }
+                gen.addAttributes(fields, size, "Cell", "Binary");
+            } else {
+                std::vector<double> values(size);
+                for(const auto& name : names) {
+                    for(std::size_t i = 0; i < size; ++i) {
+                        values[i] = *reinterpret_cast<const double*>(reinterpret_cast<const char*>(&cells[i]) + name.second);
+                    }
+
+                    gen.beginAttribute(name.first);
+                        gen.setCenter("Cell");
+                        gen.beginDataItem();
+                            gen.setDimensions(size);
+                            gen.setFormat("Binary");
+                            gen.addVector(values);
+                        gen.endDataItem();
+                    gen.endAttribute();
+                }
+            }
+            gen.endGrid();
+        gen.endDomain();
+        gen.generate("batched_attributes_benchmark.xmf");
+
+        const auto end = std::chrono::steady_clock::now();
+        std::cout << (batched ? "batched: " : "field by field: ") << std::chrono::duration<double>(end - start).count() << " s" << std::endl;
+    }
+
+    return 0;
+}
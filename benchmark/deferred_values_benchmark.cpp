@@ -0,0 +1,39 @@
+#include <simple_xdmf.hpp>
+#include <chrono>
+#include <cstdlib>
+
+// writes a Grid of many medium sized XML attributes immediately and with deferred values
+int main(int argc, char** argv) {
+    const std::size_t attribute_count = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 30;
+    const std::size_t size = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 200000;
+
+    std::vector<std::vector<double>> attributes(attribute_count, std::vector<double>(size));
+    for(std::size_t a = 0; a < attribute_count; ++a) {
+        for(std::size_t i = 0; i < size; ++i) attributes[a][i] = 0.001 * static_cast<double>((a + 1) * i);
+    }
+
+    for(const bool deferred : {false, true}) {
+        SimpleXdmf gen;
+        if (deferred) gen.setDeferredValues();
+        const auto start = std::chrono::steady_clock::now();
+
+        gen.beginDomain();
+            gen.beginGrid("Grid");
+            for(std::size_t a = 0; a < attribute_count; ++a) {
+                gen.beginAttribute("Attribute" + std::to_string(a));
+                    gen.beginDataItem();
+                        gen.setDimensions(size);
+                        gen.addVector(attributes[a]);
+                    gen.endDataItem();
+                gen.endAttribute();
+            }
+            gen.endGrid();
+        gen.endDomain();
+        gen.generate("deferred_values_benchmark.xmf");
+
+        const auto end = std::chrono::steady_clock::now();
+        std::cout << (deferred ? "deferred: " : "immediate: ") << std::chrono::duration<double>(end - start).count() << " s" << std::endl;
+    }
+
+    return 0;
+}
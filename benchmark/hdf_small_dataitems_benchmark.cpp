@@ -0,0 +1,44 @@
+#define USE_HDF5
+#include <simple_xdmf.hpp>
+#include <chrono>
+#include <cstdlib>
+
+// writes many small HDF DataItems, which are dominated by the metadata of datasets and groups
+int main(int argc, char** argv) {
+    const std::size_t grid_count = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 10000;
+    const std::size_t grid_size = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 64;
+
+    std::vector<float> values(grid_size, 1.0f);
+    for (const std::size_t compact_limit : {std::size_t(0), std::size_t(1) << 14}) {
+        SimpleXdmf gen;
+        gen.setHDFFile("hdf_small_dataitems_benchmark.h5");
+        gen.setHDFCompactLimit(compact_limit);
+
+        const auto start = std::chrono::steady_clock::now();
+
+        gen.beginDomain();
+            gen.beginGrid("Grids", "Collection");
+            for(std::size_t g = 0; g < grid_count; ++g) {
+                gen.beginGrid("Grid" + std::to_string(g));
+                    gen.beginAttribute("Values");
+                        gen.beginDataItem();
+                            gen.setDimensions(grid_size);
+                            gen.setFormat("HDF");
+                            gen.addVector(values);
+                        gen.endDataItem();
+                    gen.endAttribute();
+                gen.endGrid();
+            }
+            gen.endGrid();
+        gen.endDomain();
+        gen.generate("hdf_small_dataitems_benchmark.xmf");
+
+        const auto end = std::chrono::steady_clock::now();
+        const double seconds = std::chrono::duration<double>(end - start).count();
+
+        std::cout << "compact limit " << compact_limit << " bytes: " << grid_count << " DataItems in " << seconds << " s, "
+                  << seconds / static_cast<double>(grid_count) * 1e6 << " us per DataItem" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,39 @@
+#include <simple_xdmf.hpp>
+#include <chrono>
+#include <cstdlib>
+
+// writes a Binary DataItem with more than 2^31 generated float values
+int main(int argc, char** argv) {
+    const std::size_t size = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : (std::size_t(1) << 31) + 1024;
+    const char* heavy_data_file = (argc > 2) ? argv[2] : "/dev/null";
+
+    SimpleXdmf gen;
+    gen.setHeavyDataFile(heavy_data_file);
+
+    const auto start = std::chrono::steady_clock::now();
+
+    gen.beginDomain();
+        gen.begin3DStructuredGrid("Grid1", "3DCoRectMesh", size / (1024 * 1024), 1024, 1024);
+            gen.beginAttribute("Generated");
+                gen.beginDataItem();
+                    gen.setDimensions(size);
+                    gen.setFormat("Binary");
+                    gen.addGeneratedValues<float>(size, [](float* chunk, std::size_t offset, std::size_t count) {
+                        for(std::size_t i = 0; i < count; ++i) {
+                            chunk[i] = static_cast<float>(offset + i);
+                        }
+                    });
+                gen.endDataItem();
+            gen.endAttribute();
+        gen.end3DStructuredGrid();
+    gen.endDomain();
+    gen.generate("large_dataitem_benchmark.xmf");
+
+    const auto end = std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>(end - start).count();
+    const double bytes = static_cast<double>(size * sizeof(float));
+
+    std::cout << size << " floats (" << bytes / 1e9 << " GB): " << seconds << " s, " << bytes / seconds / 1e9 << " GB/s" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,47 @@
+#include <simple_xdmf.hpp>
+#include <chrono>
+
+// registers names of count grids and refers each of them once
+double measure(const int count) {
+    SimpleXdmf gen;
+
+    std::vector<std::string> names;
+    names.reserve(count);
+    for(int i = 0; i < count; ++i) {
+        names.emplace_back("Block" + std::to_string(i));
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    gen.beginDomain();
+        gen.beginGrid("Blocks", "Collection");
+        for(int i = 0; i < count; ++i) {
+            gen.beginGrid(names[i]);
+            gen.endGrid();
+        }
+        gen.endGrid();
+
+        gen.beginGrid("References", "Collection");
+        for(int i = 0; i < count; ++i) {
+            gen.beginGrid();
+            gen.setReferenceFromName(names[count - 1 - i]);
+            gen.endGrid();
+        }
+        gen.endGrid();
+    gen.endDomain();
+    gen.endXdmf();
+
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+int main() {
+    std::cout << "names      total [s]   per name [ns]" << std::endl;
+
+    for(int count = 1000; count <= 1000000; count *= 10) {
+        const double seconds = measure(count);
+        std::cout << count << "\t" << seconds << "\t" << seconds / count * 1e9 << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include <simple_xdmf.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+// each thread writes its own Attributes into one heavy data file by positional writes
+int main(int argc, char** argv) {
+    const std::size_t grid_size = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : std::size_t(1) << 22;
+    const std::size_t grid_count = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 64;
+    const char* heavy_data_file = (argc > 3) ? argv[3] : "parallel_heavy_data_benchmark.bin";
+    const unsigned int max_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for(unsigned int thread_count = 1; thread_count <= max_threads; thread_count *= 2) {
+        SimpleXdmf gen;
+        gen.setHeavyDataFile(heavy_data_file);
+        std::vector<SimpleXdmf::HeavyDataBlock> blocks(grid_count);
+
+        const auto start = std::chrono::steady_clock::now();
+
+        std::vector<std::thread> threads;
+        for(unsigned int t = 0; t < thread_count; ++t) {
+            threads.emplace_back([&, t]() {
+                std::vector<double> values(grid_size);
+                for(std::size_t g = t; g < grid_count; g += thread_count) {
+                    for(std::size_t i = 0; i < grid_size; ++i) {
+                        values[i] = static_cast<double>(g + i);
+                    }
+                    blocks[g] = gen.allocateHeavyData<double>(grid_size);
+                    gen.writeHeavyData(blocks[g], values.data());
+                }
+            });
+        }
+        for(auto& thread : threads) thread.join();
+
+        gen.beginDomain();
+            gen.beginGrid("Grids", "Collection");
+            for(std::size_t g = 0; g < grid_count; ++g) {
+                gen.beginGrid("Grid" + std::to_string(g));
+                    gen.beginAttribute("Values");
+                        gen.beginDataItem();
+                            gen.setDimensions(grid_size);
+                            gen.setFormat("Binary");
+                            gen.addHeavyDataBlock<double>(blocks[g]);
+                        gen.endDataItem();
+                    gen.endAttribute();
+                gen.endGrid();
+            }
+            gen.endGrid();
+        gen.endDomain();
+        gen.generate("parallel_heavy_data_benchmark.xmf");
+
+        const auto end = std::chrono::steady_clock::now();
+        const double seconds = std::chrono::duration<double>(end - start).count();
+        const double bytes = static_cast<double>(grid_size * grid_count * sizeof(double));
+
+        std::cout << thread_count << " threads: " << bytes / 1e9 << " GB in " << seconds << " s, " << bytes / seconds / 1e9 << " GB/s" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,33 @@
+#include <simple_xdmf.hpp>
+#include <chrono>
+#include <cstdlib>
+
+// writes the preview levels of a structured grid with 1 thread and with all hardware threads
+int main(int argc, char** argv) {
+    const std::size_t n = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 257; // points along each axis
+
+    std::vector<float> values(n * n * n);
+    for(std::size_t i = 0; i < values.size(); ++i) {
+        values[i] = static_cast<float>(i % 1024);
+    }
+
+    SimpleXdmf::PreviewField<float> field;
+    field.name = "Pressure";
+    field.values = values.data();
+
+    for(const unsigned int thread_count : {1u, 0u}) {
+        SimpleXdmf gen;
+        gen.setHeavyDataFile("preview_levels_benchmark.bin");
+        const auto start = std::chrono::steady_clock::now();
+
+        gen.beginDomain();
+            gen.add3DPreviewLevels<float>("Grid", n, n, n, 0.0, 0.0, 0.0, 1.0, 1.0, 1.0, {field}, "Binary", 3, thread_count);
+        gen.endDomain();
+        gen.generate("preview_levels_benchmark.xmf");
+
+        const auto end = std::chrono::steady_clock::now();
+        std::cout << (thread_count == 1 ? "1 thread: " : "all threads: ") << std::chrono::duration<double>(end - start).count() << " s" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,38 @@
+#include <simple_xdmf.hpp>
+#include <chrono>
+#include <cstdlib>
+
+// writes an n x n field given as row pointers into a Binary DataItem
+int main(int argc, char** argv) {
+    const int n = (argc > 1) ? std::atoi(argv[1]) : 8192;
+    const char* heavy_data_file = (argc > 2) ? argv[2] : "/dev/null";
+
+    std::vector<float> storage(static_cast<std::size_t>(n) * n);
+    std::vector<float*> rows(n);
+    for(int i = 0; i < n; ++i) {
+        rows[i] = storage.data() + static_cast<std::size_t>(i) * n;
+        for(int j = 0; j < n; ++j) {
+            rows[i][j] = static_cast<float>(j) * n + i;
+        }
+    }
+
+    SimpleXdmf gen;
+    gen.setHeavyDataFile(heavy_data_file);
+
+    const auto start = std::chrono::steady_clock::now();
+
+    gen.beginDataItem();
+        gen.setDimensions(n, n);
+        gen.setFormat("Binary");
+        gen.add2DArray(rows.data(), n, n);
+    gen.endDataItem();
+    gen.generate("transpose_benchmark.xmf");
+
+    const auto end = std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>(end - start).count();
+    const double bytes = static_cast<double>(storage.size() * sizeof(float));
+
+    std::cout << n << " x " << n << " float: " << seconds << " s, " << bytes / seconds / 1e9 << " GB/s" << std::endl;
+
+    return 0;
+}
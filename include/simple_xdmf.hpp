@@ -4,18 +4,149 @@
 #include <iostream>
 #include <array>
 #include <vector>
-#include <map>
+#include <unordered_map>
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <type_traits>
+#include <functional>
+#include <exception>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <memory>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SIMPLE_XDMF_POSIX
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
+#if defined(USE_IO_URING) && defined(__linux__)
+#define SIMPLE_XDMF_IO_URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+
+#ifdef USE_HDF5
+#include <hdf5.h>
+#endif
 
 #ifdef USE_BOOST
-#include <functional>
 #include <boost/array.hpp>
 #include <boost/multi_array.hpp>
 #endif
 
 class SimpleXdmf {
+    public:
+        // statistics of values added into a DataItem, see setStatistics()
+        struct DataStatistics {
+            std::string name; // Name of the enclosing Attribute
+            std::string xpath;
+            double min = 0.0;
+            double max = 0.0;
+            double mean = 0.0;
+            std::size_t count = 0;
+            std::size_t nanCount = 0;
+            std::size_t infCount = 0;
+        };
+
+        // sizes of the output computed by a dry run, see beginDryRun()
+        struct OutputPlan {
+            std::size_t documentBytes = 0; // exact when isExact, otherwise an upper bound
+            std::uint64_t heavyDataBytes = 0; // bytes appended to the heavy data file
+            std::uint64_t hdfBytes = 0; // bytes of values stored in HDF datasets, without HDF5 metadata
+            std::size_t dataItemCount = 0;
+            bool isExact = true; // false when values are written as text
+        };
+
+        // progress of the background copy of staged files, see setStagingDirectory()
+        struct DrainStatus {
+            std::size_t pendingFiles = 0;
+            std::size_t drainedFiles = 0;
+            std::size_t failedFiles = 0;
+            std::string lastError;
+        };
+
+        // layout of a shared memory snapshot, see setSharedMemoryOutput()
+        // Seek attributes of Binary DataItems are relative to heavyDataOffset.
+        // The magic is published after a release fence, so a consumer in the same process must read it
+        // with an acquire load (or issue an acquire fence after seeing it) before it reads the other fields.
+        struct SharedMemoryHeader {
+            char magic[8]; // "SXDMF01", written last
+            std::uint64_t headerSize;
+            std::uint64_t heavyDataOffset;
+            std::uint64_t heavyDataSize;
+            std::uint64_t xmlOffset;
+            std::uint64_t xmlSize;
+        };
+
+        // range of the heavy data file, see allocateHeavyData()
+        struct HeavyDataBlock {
+            std::uint64_t offset = 0; // Seek in bytes
+            std::size_t size = 0; // number of values
+            std::size_t valueSize = 0; // bytes per value
+        };
+
+        // step of a Temporal collection recorded in the index sidecar, see setTemporalIndex()
+        struct TemporalStep {
+            std::uint64_t offset = 0; // byte offset of the line of the step Grid
+            std::string time; // Value of its Time element
+        };
+
+        // step of a particle series, see addParticleStep()
+        struct ParticleStep {
+            double time = 0.0;
+            std::size_t count = 0; // number of particles
+            std::uint64_t begin = 0; // range of the step in the heavy data file, starting with the positions
+            std::uint64_t end = 0;
+        };
+
+        // block of an AMR hierarchy, see addAMRHierarchy()
+        struct AMRBlock {
+            unsigned int level = 0;
+            std::array<double, 3> origin {{0.0, 0.0, 0.0}}; // x, y, z
+            std::array<double, 3> spacing {{1.0, 1.0, 1.0}};
+            std::array<std::size_t, 3> extents {{1, 1, 1}}; // number of points along x, y, z
+        };
+
+        // values of an Attribute for each block of an AMR hierarchy, in XDMF order
+        template<typename T>
+        struct AMRField {
+            std::string name;
+            std::vector<const T*> values;
+            std::string center = "Cell"; // "Cell" or "Node"
+        };
+
+        // values of an Attribute for addAttributes(), whose item i starts at byte i * stride from values
+        template<typename T>
+        struct AttributeField {
+            std::string name;
+            const T* values = nullptr;
+            std::size_t components = 1; // 1: Scalar, 3: Vector, 6: Tensor6, 9: Tensor
+            std::size_t stride = 0; // bytes between items, 0: components * sizeof(T)
+        };
+
+        // values of an Attribute of a structured grid in XDMF order, see add3DPreviewLevels()
+        template<typename T>
+        struct PreviewField {
+            std::string name;
+            const T* values = nullptr;
+            std::string center = "Node"; // "Cell" or "Node"
+        };
+
     private:
         const std::string header = R"(<?xml version="1.0" ?>
 <!DOCTYPE Xdmf SYSTEM "Xdmf.dtd" []>
@@ -23,10 +154,815 @@ class SimpleXdmf {
         std::string content;
         std::string buffer;
         std::string newLine;
-        std::string currentXpath = "";
         bool endEdit = false;
         unsigned int innerElementPerLine = 10;
 
+#ifdef SIMPLE_XDMF_POSIX
+        // Asynchronous heavy data writer, see setAsyncHeavyData()
+        // Values are staged into aligned buffers from a reusable pool, and each filled buffer is written
+        // by io_uring (USE_IO_URING on Linux) or by worker threads while the next one is filled.
+        // Aligned buffers are written through directDescriptor (O_DIRECT) when it is available.
+        class HeavyDataEngine {
+            public:
+                enum : std::size_t { alignment = 4096 };
+
+                HeavyDataEngine(const int fd, const int direct_fd, const std::size_t buffer_size, const std::size_t buffer_count)
+                    : descriptor(fd), directDescriptor(direct_fd), bufferSize(buffer_size),
+                      jobDescriptors(buffer_count), jobOffsets(buffer_count), jobSizes(buffer_count) {
+                    for(std::size_t i = 0; i < buffer_count; ++i) {
+                        void* buffer_ptr = nullptr;
+                        if (::posix_memalign(&buffer_ptr, alignment, bufferSize) != 0) {
+                            releaseBuffers();
+                            throw std::bad_alloc();
+                        }
+                        buffers.push_back(static_cast<char*>(buffer_ptr));
+                        freeBuffers.push_back(i);
+                    }
+
+#ifdef SIMPLE_XDMF_IO_URING
+                    useRing = setupRing(static_cast<unsigned>(buffer_count));
+#endif
+                    if (!useRing) {
+                        const std::size_t thread_count = std::min<std::size_t>(buffer_count, 4);
+                        for(std::size_t i = 0; i < thread_count; ++i) {
+                            workers.emplace_back([this]() { runWorker(); });
+                        }
+                    }
+                }
+
+                ~HeavyDataEngine() {
+                    try {
+                        wait();
+                    } catch (const std::exception& e) {
+                        std::cerr << e.what() << std::endl;
+                    }
+
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        stopping = true;
+                    }
+                    jobReady.notify_all();
+                    for(auto& worker : workers) worker.join();
+
+#ifdef SIMPLE_XDMF_IO_URING
+                    teardownRing();
+#endif
+                    if (directDescriptor >= 0) ::close(directDescriptor);
+                    releaseBuffers();
+                }
+
+                const char* getName() const {
+                    return useRing ? "io_uring" : "threads";
+                }
+
+                // stage bytes to be written at offset
+                void write(const char* data, std::size_t bytes, std::uint64_t offset) {
+                    while (bytes > 0) {
+                        if (current != noBuffer && offset != currentOffset + currentSize) {
+                            submitCurrent();
+                        }
+
+                        if (current == noBuffer) {
+                            current = acquire();
+                            currentOffset = offset;
+                            currentSize = 0;
+                            // an unaligned start is written up to the next boundary, so the following buffers are aligned
+                            currentLimit = bufferSize - static_cast<std::size_t>(offset % alignment);
+                        }
+
+                        const std::size_t n = std::min(bytes, currentLimit - currentSize);
+                        std::memcpy(buffers[current] + currentSize, data, n);
+                        currentSize += n;
+                        data += n;
+                        bytes -= n;
+                        offset += n;
+
+                        if (currentSize == currentLimit) submitCurrent();
+                    }
+                }
+
+                // write the staged values and wait for all outstanding writes
+                void wait() {
+                    submitCurrent();
+
+#ifdef SIMPLE_XDMF_IO_URING
+                    if (useRing) {
+                        while (pending > 0) reapRing();
+                    }
+#endif
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        bufferFree.wait(lock, [this]() { return pending == 0; });
+                    }
+
+                    if (!error.empty()) {
+                        std::string error_message;
+                        error_message.swap(error);
+                        throw std::runtime_error(error_message);
+                    }
+                }
+
+            private:
+                enum : std::size_t { noBuffer = ~std::size_t(0) };
+
+                int descriptor;
+                int directDescriptor;
+                std::size_t bufferSize;
+                std::vector<char*> buffers;
+                std::vector<std::size_t> freeBuffers;
+                std::size_t pending = 0;
+                std::string error;
+
+                // buffer being filled
+                std::size_t current = noBuffer;
+                std::uint64_t currentOffset = 0;
+                std::size_t currentSize = 0;
+                std::size_t currentLimit = 0;
+
+                // submitted writes, indexed by buffer
+                std::vector<int> jobDescriptors;
+                std::vector<std::uint64_t> jobOffsets;
+                std::vector<std::size_t> jobSizes;
+
+                // thread pool
+                std::vector<std::thread> workers;
+                std::deque<std::size_t> jobs;
+                std::mutex mutex;
+                std::condition_variable jobReady;
+                std::condition_variable bufferFree;
+                bool stopping = false;
+                bool useRing = false;
+
+                void releaseBuffers() {
+                    for(auto buffer_ptr : buffers) std::free(buffer_ptr);
+                    buffers.clear();
+                }
+
+                static bool pwriteAll(const int fd, const char* data, std::size_t bytes, std::uint64_t offset) {
+                    while (bytes > 0) {
+                        const ssize_t written = ::pwrite(fd, data, bytes, static_cast<off_t>(offset));
+                        if (written < 0) {
+                            if (errno == EINTR) continue;
+                            return false;
+                        }
+
+                        data += written;
+                        bytes -= static_cast<std::size_t>(written);
+                        offset += static_cast<std::uint64_t>(written);
+                    }
+                    return true;
+                }
+
+                std::size_t acquire() {
+#ifdef SIMPLE_XDMF_IO_URING
+                    if (useRing) {
+                        while (freeBuffers.empty()) reapRing();
+                    }
+#endif
+                    std::unique_lock<std::mutex> lock(mutex);
+                    bufferFree.wait(lock, [this]() { return !freeBuffers.empty(); });
+
+                    const std::size_t index = freeBuffers.back();
+                    freeBuffers.pop_back();
+                    return index;
+                }
+
+                void submitCurrent() {
+                    if (current == noBuffer) return;
+
+                    const std::size_t index = current;
+                    current = noBuffer;
+                    if (currentSize == 0) {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        freeBuffers.push_back(index);
+                        return;
+                    }
+
+                    const bool is_aligned = (currentOffset % alignment == 0) && (currentSize % alignment == 0);
+                    jobDescriptors[index] = (is_aligned && directDescriptor >= 0) ? directDescriptor : descriptor;
+                    jobOffsets[index] = currentOffset;
+                    jobSizes[index] = currentSize;
+
+                    if (useRing) {
+#ifdef SIMPLE_XDMF_IO_URING
+                        ++pending;
+                        submitRing(index);
+#endif
+                        return;
+                    }
+
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        ++pending;
+                        jobs.push_back(index);
+                    }
+                    jobReady.notify_one();
+                }
+
+                void runWorker() {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    for(;;) {
+                        jobReady.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                        if (jobs.empty()) return;
+
+                        const std::size_t index = jobs.front();
+                        jobs.pop_front();
+
+                        lock.unlock();
+                        const bool succeeded = pwriteAll(jobDescriptors[index], buffers[index], jobSizes[index], jobOffsets[index]);
+                        lock.lock();
+
+                        if (!succeeded) error = "[SIMPLE XDMF ERROR] Failed to write heavy data asynchronously.";
+                        freeBuffers.push_back(index);
+                        --pending;
+                        bufferFree.notify_all();
+                    }
+                }
+
+#ifdef SIMPLE_XDMF_IO_URING
+                int ringDescriptor = -1;
+                void* sqRing = nullptr;
+                void* cqRing = nullptr;
+                std::size_t sqRingSize = 0;
+                std::size_t cqRingSize = 0;
+                io_uring_sqe* sqes = nullptr;
+                std::size_t sqesSize = 0;
+                unsigned* sqTail = nullptr;
+                unsigned* sqMask = nullptr;
+                unsigned* sqArray = nullptr;
+                unsigned* cqHead = nullptr;
+                unsigned* cqTail = nullptr;
+                unsigned* cqMask = nullptr;
+                io_uring_cqe* cqes = nullptr;
+
+                // the rings are set up by the raw system calls, so liburing is not required
+                bool setupRing(const unsigned entries) {
+                    io_uring_params params;
+                    std::memset(&params, 0, sizeof(params));
+
+                    ringDescriptor = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+                    if (ringDescriptor < 0) return false;
+
+                    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+                    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+                    const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+                    if (single_mmap) sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+
+                    sqRing = ::mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringDescriptor, IORING_OFF_SQ_RING);
+                    cqRing = single_mmap ? sqRing : ::mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringDescriptor, IORING_OFF_CQ_RING);
+                    sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+                    void* sqes_ptr = ::mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringDescriptor, IORING_OFF_SQES);
+
+                    if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqes_ptr == MAP_FAILED) {
+                        if (sqes_ptr != MAP_FAILED) ::munmap(sqes_ptr, sqesSize);
+                        sqes = nullptr;
+                        teardownRing();
+                        return false;
+                    }
+
+                    char* sq = static_cast<char*>(sqRing);
+                    char* cq = static_cast<char*>(cqRing);
+                    sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+                    sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+                    sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+                    cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+                    cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+                    cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+                    cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+                    sqes = static_cast<io_uring_sqe*>(sqes_ptr);
+                    return true;
+                }
+
+                void teardownRing() {
+                    if (sqes != nullptr) ::munmap(sqes, sqesSize);
+                    if (cqRing != nullptr && cqRing != MAP_FAILED && cqRing != sqRing) ::munmap(cqRing, cqRingSize);
+                    if (sqRing != nullptr && sqRing != MAP_FAILED) ::munmap(sqRing, sqRingSize);
+                    if (ringDescriptor >= 0) ::close(ringDescriptor);
+                    sqes = nullptr;
+                    sqRing = cqRing = nullptr;
+                    ringDescriptor = -1;
+                }
+
+                // buffers in flight never exceed the ring entries, so a slot is always available
+                void submitRing(const std::size_t index) {
+                    const unsigned tail = *sqTail;
+                    const unsigned slot = tail & *sqMask;
+
+                    io_uring_sqe* sqe = &sqes[slot];
+                    std::memset(sqe, 0, sizeof(io_uring_sqe));
+                    sqe->opcode = IORING_OP_WRITE;
+                    sqe->fd = jobDescriptors[index];
+                    sqe->addr = reinterpret_cast<std::uint64_t>(buffers[index]);
+                    sqe->len = static_cast<std::uint32_t>(jobSizes[index]);
+                    sqe->off = jobOffsets[index];
+                    sqe->user_data = index;
+
+                    sqArray[slot] = slot;
+                    __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+                    while (::syscall(__NR_io_uring_enter, ringDescriptor, 1, 0, 0, nullptr, 0) < 0) {
+                        if (errno != EINTR && errno != EAGAIN) {
+                            std::string error_message = "[SIMPLE XDMF ERROR] Failed to submit heavy data to io_uring.";
+                            throw std::runtime_error(error_message);
+                        }
+                    }
+                }
+
+                void reapRing() {
+                    const unsigned head = *cqHead;
+                    while (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+                        if (::syscall(__NR_io_uring_enter, ringDescriptor, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR) {
+                            std::string error_message = "[SIMPLE XDMF ERROR] Failed to wait for io_uring completions.";
+                            throw std::runtime_error(error_message);
+                        }
+                    }
+
+                    const io_uring_cqe& cqe = cqes[head & *cqMask];
+                    const std::size_t index = static_cast<std::size_t>(cqe.user_data);
+                    const std::int32_t result = cqe.res;
+                    __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+
+                    // short writes and kernels without IORING_OP_WRITE are completed synchronously
+                    const std::size_t written = (result > 0) ? static_cast<std::size_t>(result) : 0;
+                    if (written < jobSizes[index]) {
+                        if (!pwriteAll(descriptor, buffers[index] + written, jobSizes[index] - written, jobOffsets[index] + written)) {
+                            error = "[SIMPLE XDMF ERROR] Failed to write heavy data asynchronously.";
+                        }
+                    }
+
+                    freeBuffers.push_back(index);
+                    --pending;
+                }
+#endif
+        };
+#endif
+
+        // Work stealing pool for deferred values, see setDeferredValues()
+        // Tasks are pushed round robin into the deques of the workers. Each worker pops from the back
+        // of its own deque and steals from the front of the others when it is empty.
+        class DeferredTaskPool {
+            public:
+                explicit DeferredTaskPool(const std::size_t thread_count) : queues(thread_count) {
+                    for(std::size_t i = 0; i < thread_count; ++i) {
+                        workers.emplace_back([this, i]() { runWorker(i); });
+                    }
+                }
+
+                // queued tasks are finished before the workers stop
+                ~DeferredTaskPool() {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        stopping = true;
+                    }
+                    taskReady.notify_all();
+                    for(auto& worker : workers) worker.join();
+                }
+
+                // called only from the thread which owns the document
+                void submit(std::function<void()> task) {
+                    {
+                        std::lock_guard<std::mutex> lock(queues[next].mutex);
+                        queues[next].tasks.push_back(std::move(task));
+                    }
+                    next = (next + 1) % queues.size();
+
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        ++queued;
+                        ++pending;
+                    }
+                    taskReady.notify_one();
+                }
+
+                // wait for all submitted tasks, and throw the first error of them
+                void wait() {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    allDone.wait(lock, [this]() { return pending == 0; });
+
+                    if (error) {
+                        std::exception_ptr first_error = error;
+                        error = nullptr;
+                        std::rethrow_exception(first_error);
+                    }
+                }
+
+                std::size_t getThreadCount() const {
+                    return workers.size();
+                }
+
+            private:
+                struct Queue {
+                    std::mutex mutex;
+                    std::deque<std::function<void()>> tasks;
+                };
+
+                std::vector<Queue> queues;
+                std::vector<std::thread> workers;
+                std::size_t next = 0;
+
+                // queued counts the tasks not taken by any worker, pending the unfinished ones
+                std::mutex mutex;
+                std::condition_variable taskReady;
+                std::condition_variable allDone;
+                std::size_t queued = 0;
+                std::size_t pending = 0;
+                bool stopping = false;
+                std::exception_ptr error;
+
+                bool take(const std::size_t index, std::function<void()>& task) {
+                    {
+                        std::lock_guard<std::mutex> lock(queues[index].mutex);
+                        if (!queues[index].tasks.empty()) {
+                            task = std::move(queues[index].tasks.back());
+                            queues[index].tasks.pop_back();
+                            return true;
+                        }
+                    }
+
+                    for(std::size_t k = 1; k < queues.size(); ++k) {
+                        Queue& victim = queues[(index + k) % queues.size()];
+                        std::lock_guard<std::mutex> lock(victim.mutex);
+                        if (!victim.tasks.empty()) {
+                            task = std::move(victim.tasks.front());
+                            victim.tasks.pop_front();
+                            return true;
+                        }
+                    }
+                    return false;
+                }
+
+                void runWorker(const std::size_t index) {
+                    for(;;) {
+                        {
+                            std::unique_lock<std::mutex> lock(mutex);
+                            taskReady.wait(lock, [this]() { return stopping || queued > 0; });
+                            if (queued == 0) return;
+                            --queued;
+                        }
+
+                        // a task is reserved by the count above, so one of the deques holds it
+                        std::function<void()> task;
+                        while (!take(index, task)) std::this_thread::yield();
+
+                        std::exception_ptr task_error;
+                        try {
+                            task();
+                        } catch (...) {
+                            task_error = std::current_exception();
+                        }
+
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if (task_error && !error) error = task_error;
+                        if (--pending == 0) allDone.notify_all();
+                    }
+                }
+        };
+
+        // Background copy of staged files, see setStagingDirectory()
+        // Each job copies its files in order into a temporary file next to the destination,
+        // renames it into place and removes the staged file. Jobs run on thread_count threads.
+        class StagingDrainer {
+            public:
+                using Job = std::vector<std::pair<std::string, std::string>>; // staged path, destination
+
+                explicit StagingDrainer(const std::size_t thread_count) {
+                    for(std::size_t i = 0; i < thread_count; ++i) {
+                        workers.emplace_back([this]() { runWorker(); });
+                    }
+                }
+
+                // queued jobs are finished before the workers stop
+                ~StagingDrainer() {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        stopping = true;
+                    }
+                    jobReady.notify_all();
+                    for(auto& worker : workers) worker.join();
+                }
+
+                void submit(Job job) {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        status.pendingFiles += job.size();
+                        jobs.push_back(std::move(job));
+                    }
+                    jobReady.notify_one();
+                }
+
+                void wait() {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    allDone.wait(lock, [this]() { return status.pendingFiles == 0; });
+                }
+
+                DrainStatus getStatus() {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    return status;
+                }
+
+            private:
+                std::vector<std::thread> workers;
+                std::deque<Job> jobs;
+                std::mutex mutex;
+                std::condition_variable jobReady;
+                std::condition_variable allDone;
+                bool stopping = false;
+                DrainStatus status;
+
+                static bool copyFile(const std::string& source, const std::string& destination) {
+                    // drainers of other instances or processes may publish the same destination
+                    const std::string temporary = destination + "." + getUniqueFileTag() + ".tmp";
+                    {
+                        std::ifstream in(source, std::ios::in | std::ios::binary);
+                        std::ofstream out(temporary, std::ios::out | std::ios::binary | std::ios::trunc);
+                        if (!in.is_open() || !out.is_open()) return false;
+
+                        std::vector<char> chunk(1 << 20);
+                        while (in) {
+                            in.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+                            out.write(chunk.data(), in.gcount());
+                        }
+                        out.flush();
+                        if (!out) return false;
+                    }
+
+#ifndef SIMPLE_XDMF_POSIX
+                    // rename() does not overwrite on non POSIX systems
+                    std::remove(destination.c_str());
+#endif
+                    if (std::rename(temporary.c_str(), destination.c_str()) != 0) return false;
+                    std::remove(source.c_str());
+                    return true;
+                }
+
+                void runWorker() {
+                    for(;;) {
+                        Job job;
+                        {
+                            std::unique_lock<std::mutex> lock(mutex);
+                            jobReady.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                            if (jobs.empty()) return;
+                            job = std::move(jobs.front());
+                            jobs.pop_front();
+                        }
+
+                        // the document is published after its heavy data
+                        bool failed = false;
+                        for(const auto& file : job) {
+                            failed = failed || !copyFile(file.first, file.second);
+
+                            std::lock_guard<std::mutex> lock(mutex);
+                            if (failed) {
+                                ++status.failedFiles;
+                                status.lastError = "[SIMPLE XDMF ERROR] Failed to drain " + file.first + " into " + file.second + ".";
+                            } else {
+                                ++status.drainedFiles;
+                            }
+                            if (--status.pendingFiles == 0) allDone.notify_all();
+                        }
+                    }
+                }
+        };
+
+        // heavy data management
+        // DataItems with Format="Binary" write their values into heavyDataFileName,
+        // which is written at heavyDataPath (a file in the staging directory, see setStagingDirectory())
+        std::string heavyDataFileName;
+        std::string heavyDataPath;
+        std::ofstream heavyDataStream;
+        std::atomic<std::uint64_t> heavyDataOffset {0}; // end of the allocated ranges
+        std::uint64_t heavyDataCursor = 0; // next position written by add*() functions
+        bool isBinaryDataItem = false;
+        bool isHDFDataItem = false; // only with USE_HDF5
+
+        // the file is truncated when it is opened first, and positional writes use heavyDataDescriptor
+        std::mutex heavyDataMutex;
+        bool heavyDataFileCreated = false;
+        std::atomic<int> heavyDataDescriptor {-1};
+
+        // dry run, see beginDryRun()
+        // The document is built as usual, but values are only measured and no file is written.
+        bool dryRun = false;
+        OutputPlan dryRunPlan;
+        std::uint64_t dryRunHeavyDataStart = 0;
+#ifdef USE_HDF5
+        std::unordered_map<std::string, std::size_t> dryRunHDFDatasetCounts; // restored for the real pass
+#endif
+        bool heavyDataPreallocated = false; // the tail of a preallocated file is truncated by generate()
+
+        // memory mapped heavy data, see mapHeavyData()
+        // The mapping also points to a caller buffer or a shared memory segment, see setHeavyDataBuffer().
+        // They are plain members: the mapping is set up and released by the owning thread,
+        // never while other threads call allocateHeavyData() or writeHeavyData().
+        enum class HeavyDataSink {File, Buffer, SharedMemory};
+        char* heavyDataMapping = nullptr;
+        std::uint64_t heavyDataCapacity = 0;
+        HeavyDataSink heavyDataSink = HeavyDataSink::File;
+
+        // shared memory snapshot, see setSharedMemoryOutput()
+        enum : std::size_t { sharedMemoryHeaderSize = 4096 };
+        std::string sharedMemoryName;
+        char* sharedMemoryBase = nullptr;
+        std::size_t sharedMemorySize = 0;
+        int sharedMemoryDescriptor = -1;
+
+        // asynchronous heavy data output, see setAsyncHeavyData()
+        bool asyncHeavyData = false;
+        std::size_t asyncBufferSize = 0;
+        std::size_t asyncBufferCount = 0;
+        bool asyncDirectIO = false;
+#ifdef SIMPLE_XDMF_POSIX
+        std::unique_ptr<HeavyDataEngine> heavyDataEngine;
+#endif
+
+        // deferred values, see setDeferredValues()
+        // The text of each deferred DataItem is formatted into pieces by the pool,
+        // and spliced into content at position by commitDeferredValues().
+        struct DeferredSegment {
+            std::size_t position = 0;
+            std::vector<std::string> pieces;
+        };
+        std::deque<DeferredSegment> deferredSegments;
+        std::size_t deferredValuesPerTask = 1 << 16;
+        std::unique_ptr<DeferredTaskPool> deferredPool;
+
+        // staged output, see setStagingDirectory()
+        std::string stagingDirectory;
+        std::unique_ptr<StagingDrainer> stagingDrainer;
+
+        // "<pid>_<number>", unique among the instances of this process and the processes of the node (POSIX),
+        // which names staged files and the temporary files of the drainer
+        static std::string getUniqueFileTag() {
+            static std::atomic<std::uint64_t> fileCount {0};
+#ifdef SIMPLE_XDMF_POSIX
+            return std::to_string(::getpid()) + "_" + std::to_string(fileCount++);
+#else
+            return std::to_string(fileCount++);
+#endif
+        }
+
+        // staged files are numbered, so a file being drained is never overwritten
+        std::string getStagedPath(const std::string& file_name) {
+            const auto last_split_index = file_name.rfind('/');
+            const std::string base_name = (last_split_index == std::string::npos) ? file_name : file_name.substr(last_split_index + 1);
+            return stagingDirectory + "/" + getUniqueFileTag() + "_" + base_name;
+        }
+
+        // the heavy data file is handed to the drainer with the document, and the next document stages a new file for the same destination
+        void drainStagedFiles(const std::string& staged_document, const std::string& document, const bool has_index) {
+            StagingDrainer::Job job;
+            if (heavyDataFileCreated && heavyDataPath != heavyDataFileName) {
+                job.emplace_back(heavyDataPath, heavyDataFileName);
+            }
+            job.emplace_back(staged_document, document);
+            if (has_index) job.emplace_back(staged_document + ".idx", document + ".idx");
+
+            const std::string heavy_data_file = heavyDataFileName;
+            setHeavyDataFile(heavy_data_file);
+
+            stagingDrainer->submit(std::move(job));
+        }
+
+#ifdef USE_HDF5
+        // HDF5 heavy data, see setHDFFile()
+        // Datasets are named after the path of the enclosing elements, which uses Name attributes when they are set.
+        std::string hdfFileName;
+        hid_t hdfFile = -1;
+        bool hdfFileCreated = false;
+        std::size_t hdfChunkSize = 0; // values per chunk, 0 for contiguous datasets
+        int hdfDeflateLevel = 0;
+        bool hdfShuffle = false;
+        std::size_t hdfCompactLimit = 0; // datasets up to this size in bytes are stored in their object header
+        hid_t hdfCompactProperty = -1;
+        std::string elementPath;
+        std::vector<std::size_t> elementPathLengths;
+        std::unordered_map<std::string, hid_t> hdfGroups;
+        std::unordered_map<std::string, std::size_t> hdfDatasetCounts;
+        hid_t hdfDataset = -1;
+        std::vector<char> hdfStaging;
+#endif
+
+        // stored representation of Binary DataItems
+        std::size_t storedPrecision = 0; // 0: same as the added values
+        bool storedUnsigned = false; // store signed integers as unsigned ones
+        bool integerNarrowing = false;
+        std::string heavyDataEndian; // default of all DataItems, "" for native without Endian attribute
+        std::string dataItemEndian;
+        bool swapBytes = false;
+        bool storedRangeChecked = false; // the values of the current add*() call fit the stored type
+
+        // values streaming state of the current inner element
+        std::size_t valuesWritten = 0;
+        std::size_t valuesSize = 0;
+
+        // quantization of floating point DataItems
+        int quantizationBits = 0;
+        bool isQuantizedDataItem = false;
+        double quantizationScale = 0.0;
+        double quantizationOffset = 0.0;
+        std::string currentDimensions;
+        std::uint32_t dataItemNameEntry = noEntry; // Name of the current DataItem in nameEntries, moved into the wrapper
+
+        // particle series, see beginParticleSeries()
+        std::vector<ParticleStep> particleSteps;
+        std::size_t particleStepBase = 0; // steps written before a restart, which are not in particleSteps
+
+        // temporal index, see setTemporalIndex()
+        // The first Temporal collection of the document is indexed: the offsets and Time values of its child Grids,
+        // the offset of its closing tag (tail), and the tags of the enclosing elements to continue it.
+        // The sidecar is a header line and one line per step, all of fixed width, so step k is found by one seek.
+        enum : std::size_t { temporalIndexHeaderSize = 128, temporalIndexRecordSize = 64, temporalIndexTimeWidth = 42, temporalIndexPathOffset = 53 };
+        enum GridKind : unsigned char {OtherGrid, IndexedCollection, IndexedStep};
+        bool temporalIndexEnabled = false;
+        std::vector<unsigned char> gridKinds; // kinds of the open Grids
+        bool hasIndexedCollection = false;
+        bool indexTimePending = false;
+        std::string indexCollectionPath; // e.g. "Xdmf/Domain/Grid"
+        std::vector<TemporalStep> indexSteps;
+        std::size_t indexStepBase = 0; // steps already in the index of a continued file
+        std::uint64_t indexTail = 0;
+        std::uint64_t indexBaseOffset = 0; // offset of content in the file of a continued document
+        std::string continuedFileName;
+
+        // statistics of added values
+        bool statisticsEnabled = false;
+        bool hasStatistics = false;
+        double statisticsSum = 0.0;
+        std::string currentAttributeName;
+        DataStatistics statistics;
+        DataStatistics lastStatistics;
+        std::function<void(const DataStatistics&)> statisticsCallback;
+
+        // durable output
+        // content is streamed into durableTemporaryFileName and renamed to durableFileName by endXdmf()
+        std::FILE* durableFile = nullptr;
+        std::string durableFileName;
+        std::string durableTemporaryFileName;
+        std::size_t durableFlushInterval = 0;
+        std::size_t flushedBytes = 0;
+        bool durableSync = false;
+
+        void flushContent() {
+            commitDeferredValues();
+            if (content.empty()) return;
+
+            if (std::fwrite(content.data(), 1, content.size(), durableFile) != content.size()) {
+                std::string error_message = "[SIMPLE XDMF ERROR] Failed to write into " + durableTemporaryFileName + ".";
+                throw std::runtime_error(error_message);
+            }
+
+            flushedBytes += content.size();
+            content.clear();
+        }
+
+        void flushContentIfNeeded() {
+            if (durableFile != nullptr && content.size() >= durableFlushInterval) {
+                flushContent();
+            }
+        }
+
+        static void syncFile(const std::string& file_name) {
+#ifdef SIMPLE_XDMF_POSIX
+            const int fd = ::open(file_name.c_str(), O_RDONLY);
+            if (fd >= 0) {
+                ::fsync(fd);
+                ::close(fd);
+            }
+#endif
+        }
+
+        static std::string getDirectoryName(const std::string& file_name) {
+            const auto last_split_index = file_name.rfind("/");
+            if (last_split_index == std::string::npos) return ".";
+            if (last_split_index == 0) return "/";
+            return file_name.substr(0, last_split_index);
+        }
+
+        void finishDurableOutput() {
+            flushContent();
+            std::fflush(durableFile);
+
+            finishHeavyData(durableSync);
+
+#ifdef SIMPLE_XDMF_POSIX
+            if (durableSync) ::fsync(::fileno(durableFile));
+#endif
+            std::fclose(durableFile);
+            durableFile = nullptr;
+
+#ifndef SIMPLE_XDMF_POSIX
+            // rename() does not overwrite on non POSIX systems
+            std::remove(durableFileName.c_str());
+#endif
+            if (std::rename(durableTemporaryFileName.c_str(), durableFileName.c_str()) != 0) {
+                std::string error_message = "[SIMPLE XDMF ERROR] Failed to rename " + durableTemporaryFileName + " to " + durableFileName + ".";
+                throw std::runtime_error(error_message);
+            }
+
+            // make the rename itself durable
+            if (durableSync) syncFile(getDirectoryName(durableFileName));
+        }
+
 
         // indent management
         std::string indent;
@@ -50,106 +986,205 @@ class SimpleXdmf {
         enum class TAG {DataItem, Grid, StructuredTopology, UnstructuredTopology, Geometry, Attribute, Set, Time, Information, Domain, Xdmf, Inner};
         TAG current_tag;
 
-        void setCurrentTag(const std::string& tag) {
-            if (tag == "Grid") {
-                current_tag = TAG::Grid;
-            } else if (tag == "DataItem") {
-                current_tag = TAG::DataItem;
-            } else if (tag == "StructuredTopology") {
-                current_tag = TAG::StructuredTopology;
-            } else if (tag == "UnstructuredTopology") {
-                current_tag = TAG::UnstructuredTopology;
-            } else if (tag == "Geometry") {
-                current_tag = TAG::Geometry;
-            } else if (tag == "Attribute") {
-                current_tag = TAG::Attribute;
-            } else if (tag == "Set") {
-                current_tag = TAG::Set;
-            } else if (tag == "Time") {
-                current_tag = TAG::Time;
-            } else if (tag == "Domain") {
-                current_tag = TAG::Domain;
-            } else if (tag == "Information") {
-                current_tag = TAG::Information;
-            } else if (tag == "Inner") {
-                current_tag = TAG::Inner;
-            } else if (tag == "Xdmf") {
-                current_tag = TAG::Xdmf;
-            }
-        }
 
 
         // Reference Management
-        // xpathMap[Name] => Xpath
-        std::map<std::string, std::string> xpathMap;
+        // Element paths are interned as a tree of xpathNodes (parent node and tag),
+        // and each Name is registered with the node of its element.
+        // xpathNodes[0] is the root, i.e. the empty path.
+        struct XpathNode {
+            std::uint32_t parent;
+            TAG tag;
+        };
+
+        struct NameEntry {
+            std::uint32_t node;
+            std::uint32_t ordinal; // position among elements with the same path and Name
+            std::uint32_t next; // next element with the same Name
+            std::uint32_t name; // id of the Name
+        };
+
+        struct NameList {
+            std::uint32_t first; // first and last entries in nameEntries
+            std::uint32_t last;
+            std::uint32_t id; // number of the Name
+        };
+
+        enum : std::uint32_t { noEntry = 0xFFFFFFFFu };
 
-        void addNewXpath(const std::string& name, const std::string& xpath) {
-            if (xpathMap.count(name) == 0) {
-                xpathMap[name] = xpath;
+        std::vector<XpathNode> xpathNodes {{XpathNode{0, TAG::Xdmf}}};
+        std::unordered_map<std::uint64_t, std::uint32_t> xpathChildren;
+        std::uint32_t currentXpathNode = 0;
+
+        std::unordered_map<std::string, NameList> nameRegistry;
+        std::vector<NameEntry> nameEntries;
+        // nameCounts[(Name id, node)] => number of elements with the Name at the node
+        std::unordered_map<std::uint64_t, std::uint32_t> nameCounts;
+        bool positionalXpath = false;
+
+        static std::uint64_t getNameCountKey(const std::uint32_t id, const std::uint32_t node) {
+            return (static_cast<std::uint64_t>(id) << 32) | static_cast<std::uint64_t>(node);
+        }
+
+        // returns the registered entry, or noEntry
+        std::uint32_t addNewXpath(const std::string& name, const std::uint32_t node) {
+            const auto found = nameRegistry.find(name);
+            const auto index = static_cast<std::uint32_t>(nameEntries.size());
+
+            if (found == nameRegistry.end()) {
+                const auto id = static_cast<std::uint32_t>(nameRegistry.size());
+                nameEntries.push_back(NameEntry{node, 0, noEntry, id});
+                nameRegistry.emplace(name, NameList{index, index, id});
+                nameCounts[getNameCountKey(id, node)] = 1;
+                return index;
             }
+
+            // duplicated names are registered only for positional xpaths
+            if (!positionalXpath) return noEntry;
+
+            auto& entries = found->second;
+            const std::uint32_t ordinal = nameCounts[getNameCountKey(entries.id, node)]++;
+
+            nameEntries.push_back(NameEntry{node, ordinal, noEntry, entries.id});
+            nameEntries[entries.last].next = index;
+            entries.last = index;
+            return index;
         }
 
-        std::string getXpath(const std::string& name) {
-            if (xpathMap.count(name) > 0) {
-                return xpathMap[name] + "[@Name='" + name + "']";
-            } else {
-                std::cerr << "[SIMPLE XDMF ERROR] Non-existente Name \"" << name << "\" passed to getXpath(). " << std::endl;
-                return "";
+        // move the latest entry of its path to another node, e.g. into a wrapping element
+        void moveXpathEntry(const std::uint32_t index, const std::uint32_t node) {
+            auto& entry = nameEntries[index];
+            --nameCounts[getNameCountKey(entry.name, entry.node)];
+            entry.node = node;
+            entry.ordinal = nameCounts[getNameCountKey(entry.name, node)]++;
+        }
+
+        void appendXpathNode(std::string& out, const std::uint32_t node) const {
+            if (node == 0) return;
+
+            appendXpathNode(out, xpathNodes[node].parent);
+            out += '/';
+            out += getTagString(xpathNodes[node].tag);
+        }
+
+        // occurrence-th element named name, counted from 0.
+        // Duplicated names are addressed as "(/Xdmf/Domain/Grid[@Name='name'])[2]".
+        bool appendXpath(std::string& out, const std::string& name, const std::size_t occurrence = 0) const {
+            const auto found = nameRegistry.find(name);
+
+            auto index = (found != nameRegistry.end()) ? found->second.first : noEntry;
+            for(std::size_t n = 0; n < occurrence && index != noEntry; ++n) {
+                index = nameEntries[index].next;
+            }
+
+            if (index == noEntry) {
+                std::cerr << "[SIMPLE XDMF ERROR] Non-existente Name \"" << name << "\" (occurrence " << occurrence << ") passed to getXpath(). " << std::endl;
+                return false;
             }
+
+            const auto& entry = nameEntries[index];
+            if (entry.ordinal > 0) out += '(';
+
+            appendXpathNode(out, entry.node);
+            out += "[@Name='";
+            out += name;
+            out += "']";
+
+            if (entry.ordinal > 0) {
+                out += ")[";
+                appendValue(out, entry.ordinal + 1);
+                out += ']';
+            }
+            return true;
+        }
+
+        std::string getXpath(const std::string& name, const std::size_t occurrence = 0) const {
+            std::string xpath;
+            appendXpath(xpath, name, occurrence);
+            return xpath;
         }
 
         void proceedCurrentXpath() {
-            currentXpath += "/" + getCurrentTagString();
+            const std::uint64_t key = (static_cast<std::uint64_t>(currentXpathNode) << 8) | static_cast<std::uint64_t>(current_tag);
+            const auto found = xpathChildren.find(key);
+
+            if (found != xpathChildren.end()) {
+                currentXpathNode = found->second;
+                return;
+            }
+
+            const auto node = static_cast<std::uint32_t>(xpathNodes.size());
+            xpathNodes.push_back(XpathNode{currentXpathNode, current_tag});
+            xpathChildren.emplace(key, node);
+            currentXpathNode = node;
         }
 
         void regressCurrentXpath() {
-            auto last_split_index = currentXpath.rfind("/");
-            currentXpath.erase(currentXpath.begin() + last_split_index, currentXpath.end());
+            currentXpathNode = xpathNodes[currentXpathNode].parent;
         }
 
 
         // Structure Management
-        void beginElement(const std::string& tag) {
+        void beginElement(const TAG tag) {
             if (buffer != "") {
                 commitBuffer();
             }
 
             addIndent();
             insertIndent();
-            setCurrentTag(tag);
+            current_tag = tag;
 
-            buffer += "<" + getCurrentTagString();
+            buffer += '<';
+            buffer += getCurrentTagString();
             proceedCurrentXpath();
+#ifdef USE_HDF5
+            pushElementPath(tag);
+#endif
         }
 
-        void endElement(const std::string& tag) {
+        void endElement(const TAG tag) {
             if (buffer != "") {
                 commitBuffer();
             }
 
             insertIndent();
-            buffer += "</" + convertTagString(tag);
+            buffer += "</";
+            buffer += getTagString(tag);
             commitBuffer();
 
             regressCurrentXpath();
+#ifdef USE_HDF5
+            popElementPath();
+#endif
             backIndent();
         }
 
         void commitBuffer() {
-            content += buffer + ">" + newLine;
+            content += buffer;
+            content += '>';
+            content += newLine;
             buffer.clear();
+            flushContentIfNeeded();
         }
 
-        void endOneLineElement(const std::string& tag) {
+        void endOneLineElement() {
             if (buffer != "") {
                 commitOneLineBuffer();
             }
+
+            regressCurrentXpath();
+#ifdef USE_HDF5
+            popElementPath();
+#endif
             backIndent();
         }
 
         void commitOneLineBuffer() {
-            content += buffer + "/>" + newLine;
+            content += buffer;
+            content += "/>";
+            content += newLine;
             buffer.clear();
+            flushContentIfNeeded();
         }
 
         void beginInnerElement() {
@@ -159,7 +1194,7 @@ class SimpleXdmf {
             addIndent();
             insertIndent();
 
-            setCurrentTag("Inner");
+            current_tag = TAG::Inner;
         }
 
         void endInnerElement() {
@@ -172,6 +1207,7 @@ class SimpleXdmf {
         void commitInnerBuffer() {
             content += buffer;
             buffer.clear();
+            flushContentIfNeeded();
         }
 
 
@@ -265,8 +1301,8 @@ class SimpleXdmf {
             return isValid;
         }
 
-        std::string getCurrentTagString() {
-            switch (current_tag) {
+        static const char* getTagString(const TAG tag) {
+            switch (tag) {
                 case TAG::Grid:
                     return "Grid";
                 case TAG::DataItem:
@@ -296,12 +1332,8 @@ class SimpleXdmf {
             }
         }
 
-        std::string convertTagString(const std::string& tag) {
-            if (tag == "StructuredTopology" || tag == "UnstructuredTopology") {
-                return "Topology";
-            } else {
-                return tag;
-            }
+        const char* getCurrentTagString() const {
+            return getTagString(current_tag);
         }
 
         // Adding Valid Attributes
@@ -309,376 +1341,2957 @@ class SimpleXdmf {
             if (type == "") return;
 
             if (checkType(type)) {
-                auto typeString = getCurrentTagString();
                 // irregular naming of data type attribute ....
-                if (typeString == "DataItem") typeString = "Item";
-
-                buffer += " " + typeString + "Type=\"" + type + "\"";
+                buffer += ' ';
+                buffer += (current_tag == TAG::DataItem) ? "Item" : getCurrentTagString();
+                buffer += "Type=\"";
+                buffer += type;
+                buffer += '"';
             }
         }
 
 
-        // for convinience
-        void convertFromVariadicArgsToStringInternal(const std::string& buffer) {}
+        // Text formatting
+        // values are appended directly into the destination string without temporary strings.
+        // Output is identical to std::ostream with default settings, except for 1 byte integers
+        // which are printed as numbers.
+        static void appendValue(std::string& out, const std::string& value) {
+            out += value;
+        }
 
-        template<typename First, typename... Rests>
-        void convertFromVariadicArgsToStringInternal(std::string& buffer, First&& first, Rests&&... rests) {
+        static void appendValue(std::string& out, const char* value) {
+            out += value;
+        }
+
+        static void appendValue(std::string& out, const char value) {
+            out += value;
+        }
+
+        static void appendValue(std::string& out, const bool value) {
+            out += value ? '1' : '0';
+        }
+
+        template<typename T>
+        static bool isNegative(const T value, std::true_type) {
+            return value < 0;
+        }
+
+        template<typename T>
+        static bool isNegative(const T, std::false_type) {
+            return false;
+        }
+
+        template<typename T>
+        static typename std::enable_if<std::is_integral<T>::value>::type appendValue(std::string& out, const T value) {
+            using U = typename std::make_unsigned<T>::type;
+            const bool negative = isNegative(value, std::is_signed<T>());
+            U u = negative ? static_cast<U>(U(0) - static_cast<U>(value)) : static_cast<U>(value);
+
+            char digits[24];
+            char* const last = digits + sizeof(digits);
+            char* first = last;
+            do {
+                *--first = static_cast<char>('0' + u % 10);
+                u /= 10;
+            } while (u != 0);
+
+            if (negative) *--first = '-';
+            out.append(first, last);
+        }
+
+        template<typename T>
+        static typename std::enable_if<std::is_floating_point<T>::value>::type appendValue(std::string& out, const T value) {
+            char chars[64];
+            const int length = std::is_same<T, long double>::value
+                ? std::snprintf(chars, sizeof(chars), "%Lg", static_cast<long double>(value))
+                : std::snprintf(chars, sizeof(chars), "%g", static_cast<double>(value));
+            out.append(chars, static_cast<std::size_t>(length));
+        }
+
+        // any other types are formatted by operator<<
+        template<typename T>
+        static typename std::enable_if<!std::is_arithmetic<T>::value && !std::is_convertible<T, std::string>::value>::type appendValue(std::string& out, const T& value) {
             std::stringstream ss;
-            ss << first;
-            buffer = ss.str() + buffer;
+            ss << value;
+            out += ss.str();
+        }
+
+        // setDimensions(nx, ny, nz) is written as "nz ny nx"
+        static void appendReversedArgs(std::string&) {}
+
+        template<typename First, typename... Rests>
+        static void appendReversedArgs(std::string& out, First&& first, Rests&&... rests) {
+            appendReversedArgs(out, std::forward<Rests>(rests)...);
 
             constexpr std::size_t parameter_pack_size = sizeof...(Rests);
             if (parameter_pack_size > 0) {
-                buffer = " " + buffer;
-                convertFromVariadicArgsToStringInternal(buffer, std::forward<Rests>(rests)...);
+                out += ' ';
             }
+            appendValue(out, first);
         }
 
-        template<typename... Args>
-        std::string convertFromVariadicArgsToString(Args&&... args) {
-            std::string buffer = "";
-            convertFromVariadicArgsToStringInternal(buffer, std::forward<Args>(args)...);
-            return buffer;
-        }
-
-        void addItemInternal(std::stringstream& ss) {}
+        static void appendArgs(std::string&) {}
 
-        template <typename First, typename... Rests>
-        void addItemInternal(std::stringstream &ss, First &&first, Rests &&... rests) {
-            ss << first;
+        template<typename First, typename... Rests>
+        static void appendArgs(std::string& out, First&& first, Rests&&... rests) {
+            appendValue(out, first);
 
             constexpr std::size_t parameter_pack_size = sizeof...(Rests);
             if (parameter_pack_size > 0) {
-                ss << " ";
-                addItemInternal(ss, std::forward<Rests>(rests)...);
+                out += ' ';
+                appendArgs(out, std::forward<Rests>(rests)...);
             }
         }
 
-    public:
-        SimpleXdmf() {
-            setNewLineCodeLF();
-            setIndentSpaceSize();
-            beginXdmf();
+        void appendAttribute(const char* key, const std::string& value) {
+            buffer += ' ';
+            buffer += key;
+            buffer += "=\"";
+            buffer += value;
+            buffer += '"';
         }
 
-        void setIndentSpaceSize(const int size = 4) {
-            if (size == 0) {
-                indent = '\t';
+        // Values streaming
+        // beginValues() / writeValues() / endValues() emit a sequence of size values,
+        // passed in arbitrary chunks, as the inner element of the current tag.
+        static const char* getNumberTypeString(const bool is_floating_point, const bool is_signed, const std::size_t size) {
+            return is_floating_point ? "Float"
+                : (size == 1 ? (is_signed ? "Char" : "UChar")
+                             : (is_signed ? "Int" : "UInt"));
+        }
+
+        template<typename T>
+        static const char* getNumberTypeString() {
+            return getNumberTypeString(std::is_floating_point<T>::value, std::is_signed<T>::value, sizeof(T));
+        }
+
+        static const char* getPrecisionString(const std::size_t size) {
+            return size == 1 ? "1" : (size == 2 ? "2" : (size == 4 ? "4" : "8"));
+        }
+
+        // Conversion of Binary heavy data
+        // Values are converted to storedPrecision bytes and swapped into the target byte order
+        // chunk by chunk while they are written.
+        static bool isLittleEndianHost() {
+            const std::uint16_t probe = 1;
+            return *reinterpret_cast<const unsigned char*>(&probe) == 1;
+        }
+
+        template<std::size_t Size, bool Signed>
+        using IntegerType = typename std::conditional<Size == 1, typename std::conditional<Signed, std::int8_t, std::uint8_t>::type,
+                            typename std::conditional<Size == 2, typename std::conditional<Signed, std::int16_t, std::uint16_t>::type,
+                            typename std::conditional<Size == 4, typename std::conditional<Signed, std::int32_t, std::uint32_t>::type,
+                                                                 typename std::conditional<Signed, std::int64_t, std::uint64_t>::type>::type>::type>::type;
+
+        template<typename T, std::size_t Size, bool Signed>
+        using StoredType = typename std::conditional<std::is_floating_point<T>::value,
+                                                     typename std::conditional<Size == 4, float, double>::type,
+                                                     IntegerType<Size, Signed>>::type;
+
+        static std::uint8_t byteSwap(const std::uint8_t v) { return v; }
+        static std::uint16_t byteSwap(const std::uint16_t v) { return static_cast<std::uint16_t>((v >> 8) | (v << 8)); }
+        static std::uint32_t byteSwap(const std::uint32_t v) {
+            return ((v & 0x000000FFu) << 24) | ((v & 0x0000FF00u) << 8) | ((v & 0x00FF0000u) >> 8) | ((v & 0xFF000000u) >> 24);
+        }
+        static std::uint64_t byteSwap(const std::uint64_t v) {
+            return (static_cast<std::uint64_t>(byteSwap(static_cast<std::uint32_t>(v))) << 32) | byteSwap(static_cast<std::uint32_t>(v >> 32));
+        }
+
+        // swap bytes of values in place, through unsigned integers of the same size
+        template<typename S>
+        static void byteSwapValues(S* values_ptr, const std::size_t count) {
+            using U = IntegerType<sizeof(S), false>;
+            for(std::size_t i = 0; i < count; ++i) {
+                U u;
+                std::memcpy(&u, &values_ptr[i], sizeof(S));
+                u = byteSwap(u);
+                std::memcpy(&values_ptr[i], &u, sizeof(S));
+            }
+        }
+
+        template<typename S, typename T>
+        static void checkStoredRange(const T* values_ptr, const std::size_t count, std::true_type) {
+            if (count == 0) return;
+
+            T min_v = std::numeric_limits<T>::max();
+            T max_v = std::numeric_limits<T>::lowest();
+            for(std::size_t i = 0; i < count; ++i) {
+                min_v = (values_ptr[i] < min_v) ? values_ptr[i] : min_v;
+                max_v = (values_ptr[i] > max_v) ? values_ptr[i] : max_v;
+            }
+
+            bool overflow = false;
+            if (std::is_signed<T>::value && !std::is_signed<S>::value) {
+                overflow = isNegative(min_v, std::is_signed<T>());
+            } else if (std::is_signed<T>::value && sizeof(S) < sizeof(T)) {
+                overflow = min_v < static_cast<T>(std::numeric_limits<S>::lowest());
+            }
+
+            // the maximum of S is compared only if it is representable by T
+            if (sizeof(S) < sizeof(T) || (sizeof(S) == sizeof(T) && std::is_signed<S>::value && !std::is_signed<T>::value)) {
+                overflow = overflow || max_v > static_cast<T>(std::numeric_limits<S>::max());
+            }
+
+            if (overflow) {
+                std::string error_message = "[SIMPLE XDMF ERROR] Values overflow the stored Precision = " + std::to_string(sizeof(S)) + ".";
+                throw std::overflow_error(error_message);
+            }
+        }
+
+        // floating point values are rounded
+        template<typename S, typename T>
+        static void checkStoredRange(const T*, const std::size_t, std::false_type) {}
+
+        // Heavy data output
+        // add*() functions write sequentially from heavyDataCursor, into the mapping after mapHeavyData(),
+        // and into the stream otherwise. Blocks of allocateHeavyData() are written by positional writes.
+        void openHeavyDataStream() {
+            std::lock_guard<std::mutex> lock(heavyDataMutex);
+
+            if (heavyDataFileCreated) {
+                heavyDataStream.open(heavyDataPath, std::ios::in | std::ios::out | std::ios::binary);
+            } else {
+                heavyDataStream.open(heavyDataPath, std::ios::out | std::ios::binary | std::ios::trunc);
+                heavyDataFileCreated = true;
+            }
+
+            heavyDataStream.seekp(static_cast<std::streamoff>(heavyDataCursor));
+        }
+
+        void startHeavyDataEngine() {
+#ifdef SIMPLE_XDMF_POSIX
+            const int fd = openHeavyDataDescriptor();
+
+            int direct_fd = -1;
+#ifdef O_DIRECT
+            // file systems without O_DIRECT support fall back to the page cache
+            if (asyncDirectIO) direct_fd = ::open(heavyDataPath.c_str(), O_WRONLY | O_DIRECT);
+#endif
+            heavyDataEngine.reset(new HeavyDataEngine(fd, direct_fd, asyncBufferSize, asyncBufferCount));
+#endif
+        }
+
+        void stopHeavyDataEngine() {
+#ifdef SIMPLE_XDMF_POSIX
+            if (heavyDataEngine) {
+                heavyDataEngine->wait();
+                heavyDataEngine.reset();
+            }
+#endif
+        }
+
+        bool hasHeavyDataEngine() const {
+#ifdef SIMPLE_XDMF_POSIX
+            return heavyDataEngine != nullptr;
+#else
+            return false;
+#endif
+        }
+
+        void prepareHeavyDataOutput() {
+            if (heavyDataMapping != nullptr) return;
+
+            if (asyncHeavyData) {
+                if (!hasHeavyDataEngine()) startHeavyDataEngine();
                 return;
             }
 
-            indent.clear();
-            for (int i = 0; i < size; ++i) {
-                indent += ' ';
+            if (!heavyDataStream.is_open()) openHeavyDataStream();
+        }
+
+        int openHeavyDataDescriptor() {
+#ifdef SIMPLE_XDMF_POSIX
+            int fd = heavyDataDescriptor.load(std::memory_order_acquire);
+            if (fd >= 0) return fd;
+
+            std::lock_guard<std::mutex> lock(heavyDataMutex);
+            fd = heavyDataDescriptor.load(std::memory_order_relaxed);
+            if (fd >= 0) return fd;
+
+            if (heavyDataFileName == "") {
+                std::string error_message = "[SIMPLE XDMF ERROR] setHeavyDataFile() must be called before writing heavy data.";
+                throw std::runtime_error(error_message);
+            }
+
+            fd = ::open(heavyDataPath.c_str(), O_RDWR | O_CREAT | (heavyDataFileCreated ? 0 : O_TRUNC), 0644);
+            if (fd < 0) {
+                std::string error_message = "[SIMPLE XDMF ERROR] Failed to open " + heavyDataFileName + ".";
+                throw std::runtime_error(error_message);
             }
+
+            heavyDataFileCreated = true;
+            heavyDataDescriptor.store(fd, std::memory_order_release);
+            return fd;
+#else
+            std::string error_message = "[SIMPLE XDMF ERROR] Positional heavy data writes are supported only on POSIX systems.";
+            throw std::runtime_error(error_message);
+#endif
         }
 
-        void setNewLineCodeLF() {
-            constexpr char LF = '\n';
-            newLine = LF;
+        void closeHeavyData() {
+            if (heavyDataStream.is_open()) {
+                heavyDataStream.close();
+            }
+            unmapHeavyData(false);
+            releaseSharedMemory();
+            heavyDataMapping = nullptr;
+            heavyDataCapacity = 0;
+            heavyDataSink = HeavyDataSink::File;
+
+#ifdef SIMPLE_XDMF_POSIX
+            // outstanding writes are finished by the destructor of the engine
+            heavyDataEngine.reset();
+#endif
+
+#ifdef SIMPLE_XDMF_POSIX
+            const int fd = heavyDataDescriptor.exchange(-1);
+            if (fd >= 0) ::close(fd);
+#endif
+            heavyDataFileCreated = false;
+            heavyDataPreallocated = false;
         }
 
-        void setNewLineCodeCR() {
-            constexpr char CR = '\r';
-            newLine = CR;
+        // values of a DataItem are contiguous, so they are allocated when the DataItem starts,
+        // and following add*() calls must continue just after the previous one.
+        void allocateValues(const std::uint64_t bytes, const bool is_continued) {
+            const std::uint64_t offset = heavyDataOffset.fetch_add(bytes);
+            if (offset == heavyDataCursor) return;
+
+            if (is_continued) {
+                std::string error_message = "[SIMPLE XDMF ERROR] Values of a DataItem are not contiguous, since heavy data is allocated by another thread while they are added.";
+                throw std::runtime_error(error_message);
+            }
+
+            heavyDataCursor = offset;
+            if (heavyDataStream.is_open()) {
+                heavyDataStream.seekp(static_cast<std::streamoff>(heavyDataCursor));
+            }
         }
 
-        void setNewLineCodeCRLF() {
-            constexpr const char* CRLF = "\r\n";
-            newLine = CRLF;
+        void writeHeavyData(const void* data, const std::size_t bytes) {
+            if (heavyDataMapping != nullptr) {
+                if (heavyDataCursor + bytes > heavyDataCapacity) {
+                    std::string error_message = "[SIMPLE XDMF ERROR] Values exceed the capacity of the mapped heavy data file " + heavyDataFileName + ".";
+                    throw std::length_error(error_message);
+                }
+                std::memcpy(heavyDataMapping + heavyDataCursor, data, bytes);
+#ifdef SIMPLE_XDMF_POSIX
+            } else if (heavyDataEngine) {
+                heavyDataEngine->write(static_cast<const char*>(data), bytes, heavyDataCursor);
+#endif
+            } else {
+                heavyDataStream.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+            }
+
+            heavyDataCursor += bytes;
         }
 
-        // IO functions
-        void generate(const std::string file_name) {
-            if(!endEdit) endXdmf();
+        void unmapHeavyData(const bool sync) {
+#ifdef SIMPLE_XDMF_POSIX
+            // buffers and shared memory are kept until closeHeavyData()
+            if (heavyDataMapping == nullptr || heavyDataSink != HeavyDataSink::File) return;
+
+            ::msync(heavyDataMapping, static_cast<std::size_t>(heavyDataCapacity), sync ? MS_SYNC : MS_ASYNC);
+            ::munmap(heavyDataMapping, static_cast<std::size_t>(heavyDataCapacity));
+            heavyDataMapping = nullptr;
+            heavyDataCapacity = 0;
+
+            // drop the unused part of the preallocated capacity
+            if (::ftruncate(heavyDataDescriptor, static_cast<off_t>(heavyDataOffset.load())) != 0) {
+                std::cerr << "[SIMPLE XDMF ERROR] Failed to truncate " << heavyDataFileName << "." << std::endl;
+            }
+#else
+            (void)sync;
+#endif
+        }
+
+        void releaseSharedMemory() {
+#ifdef SIMPLE_XDMF_POSIX
+            if (sharedMemoryBase != nullptr) ::munmap(sharedMemoryBase, sharedMemorySize);
+            if (sharedMemoryDescriptor >= 0) ::close(sharedMemoryDescriptor);
+#endif
+            sharedMemoryBase = nullptr;
+            sharedMemorySize = 0;
+            sharedMemoryDescriptor = -1;
+            sharedMemoryName.clear();
+        }
+
+        void finishHeavyData(const bool sync) {
+#ifdef USE_HDF5
+            closeHDFFile();
+#endif
+            if (heavyDataStream.is_open()) {
+                heavyDataStream.flush();
+                if (sync) syncFile(heavyDataPath);
+            }
+
+#ifdef SIMPLE_XDMF_POSIX
+            // only outstanding writes are waited for
+            if (heavyDataEngine) heavyDataEngine->wait();
+#endif
+
+            unmapHeavyData(sync);
+
+#ifdef SIMPLE_XDMF_POSIX
+            const int fd = heavyDataDescriptor.load();
+            if (heavyDataPreallocated && fd >= 0) {
+                if (::ftruncate(fd, static_cast<off_t>(heavyDataOffset.load())) != 0) {
+                    std::cerr << "[SIMPLE XDMF ERROR] Failed to truncate " << heavyDataFileName << "." << std::endl;
+                }
+                heavyDataPreallocated = false;
+            }
+            if (sync && fd >= 0) ::fsync(fd);
+#endif
+        }
+
+#ifdef USE_HDF5
+        // HDF5 output
+        void pushElementPath(const TAG tag) {
+            elementPathLengths.push_back(elementPath.size());
+            if (tag == TAG::Xdmf) return;
+
+            elementPath += '/';
+            elementPath += getTagString(tag);
+        }
+
+        void popElementPath() {
+            if (elementPathLengths.empty()) return;
+
+            elementPath.resize(elementPathLengths.back());
+            elementPathLengths.pop_back();
+        }
+
+        // a named element appears by its name in the dataset paths
+        void setElementPathName(const std::string& name) {
+            if (elementPathLengths.empty() || current_tag == TAG::Xdmf) return;
+
+            elementPath.resize(elementPathLengths.back());
+            elementPath += '/';
+            for(const char c : name) {
+                elementPath += (c == '/' || c == ':') ? '_' : c;
+            }
+        }
+
+        static void checkHDFResult(const herr_t result, const std::string& operation) {
+            if (result < 0) {
+                std::string error_message = "[SIMPLE XDMF ERROR] Failed to " + operation + " in the HDF5 file.";
+                throw std::runtime_error(error_message);
+            }
+        }
+
+        void openHDFFile() {
+            if (hdfFileName == "") {
+                std::string error_message = "[SIMPLE XDMF ERROR] setHDFFile() must be called before adding values to an HDF DataItem.";
+                throw std::runtime_error(error_message);
+            }
+
+            // the latest format keeps links of groups compact, and metadata is aggregated into large blocks
+            const hid_t access_property = H5Pcreate(H5P_FILE_ACCESS);
+            H5Pset_libver_bounds(access_property, H5F_LIBVER_LATEST, H5F_LIBVER_LATEST);
+            H5Pset_meta_block_size(access_property, 1 << 20);
+            H5Pset_small_data_block_size(access_property, 1 << 20);
+
+            if (hdfFileCreated) {
+                hdfFile = H5Fopen(hdfFileName.c_str(), H5F_ACC_RDWR, access_property);
+            } else {
+                hdfFile = H5Fcreate(hdfFileName.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, access_property);
+                hdfFileCreated = true;
+            }
+            H5Pclose(access_property);
+
+            if (hdfFile < 0) {
+                std::string error_message = "[SIMPLE XDMF ERROR] Failed to open " + hdfFileName + ".";
+                throw std::runtime_error(error_message);
+            }
+
+            hdfCompactProperty = H5Pcreate(H5P_DATASET_CREATE);
+            H5Pset_layout(hdfCompactProperty, H5D_COMPACT);
+        }
+
+        void closeHDFFile() {
+            if (hdfFile < 0) return;
+
+            if (hdfDataset >= 0) H5Dclose(hdfDataset);
+            hdfDataset = -1;
+
+            for(const auto& group : hdfGroups) H5Gclose(group.second);
+            hdfGroups.clear();
+
+            H5Pclose(hdfCompactProperty);
+            hdfCompactProperty = -1;
+            H5Fclose(hdfFile);
+            hdfFile = -1;
+        }
+
+        // groups stay open until the file is closed, so sibling datasets do not look up their path again
+        hid_t getHDFGroup(const std::string& path) {
+            if (path == "") return hdfFile;
+
+            const auto found = hdfGroups.find(path);
+            if (found != hdfGroups.end()) return found->second;
+
+            const auto split_index = path.rfind('/');
+            const hid_t parent = getHDFGroup(path.substr(0, split_index));
+            const std::string leaf = path.substr(split_index + 1);
+
+            const hid_t group = (H5Lexists(parent, leaf.c_str(), H5P_DEFAULT) > 0)
+                ? H5Gopen2(parent, leaf.c_str(), H5P_DEFAULT)
+                : H5Gcreate2(parent, leaf.c_str(), H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+            if (group < 0) {
+                std::string error_message = "[SIMPLE XDMF ERROR] Failed to create the group " + path + " in " + hdfFileName + ".";
+                throw std::runtime_error(error_message);
+            }
+
+            hdfGroups.emplace(path, group);
+            return group;
+        }
+
+        static hid_t getHDFIntegerType(const std::size_t size, const bool is_signed, const bool is_big_endian) {
+            switch (size) {
+                case 1: return is_signed ? (is_big_endian ? H5T_STD_I8BE : H5T_STD_I8LE) : (is_big_endian ? H5T_STD_U8BE : H5T_STD_U8LE);
+                case 2: return is_signed ? (is_big_endian ? H5T_STD_I16BE : H5T_STD_I16LE) : (is_big_endian ? H5T_STD_U16BE : H5T_STD_U16LE);
+                case 4: return is_signed ? (is_big_endian ? H5T_STD_I32BE : H5T_STD_I32LE) : (is_big_endian ? H5T_STD_U32BE : H5T_STD_U32LE);
+                default: return is_signed ? (is_big_endian ? H5T_STD_I64BE : H5T_STD_I64LE) : (is_big_endian ? H5T_STD_U64BE : H5T_STD_U64LE);
+            }
+        }
+
+        static hid_t getHDFType(const bool is_floating, const bool is_signed, const std::size_t size, const bool is_big_endian) {
+            if (is_floating) {
+                if (size == 4) return is_big_endian ? H5T_IEEE_F32BE : H5T_IEEE_F32LE;
+                return is_big_endian ? H5T_IEEE_F64BE : H5T_IEEE_F64LE;
+            }
+            return getHDFIntegerType(size, is_signed, is_big_endian);
+        }
+
+        template<typename T>
+        static hid_t getHDFMemoryType(std::true_type) {
+            return getHDFType(std::is_floating_point<T>::value, std::is_signed<T>::value, sizeof(T), !isLittleEndianHost());
+        }
+
+        template<typename T>
+        static hid_t getHDFMemoryType(std::false_type) {
+            std::string error_message = "[SIMPLE XDMF ERROR] Only arithmetic values can be added to an HDF DataItem.";
+            throw std::invalid_argument(error_message);
+        }
+
+        // the dimensions of the DataItem, or one dimension when they do not match the number of values
+        std::vector<hsize_t> getHDFDimensions(const std::size_t size) const {
+            std::vector<hsize_t> dimensions;
+            std::stringstream ss(currentDimensions);
+            hsize_t dimension;
+            hsize_t total = 1;
+            while (ss >> dimension) {
+                dimensions.push_back(dimension);
+                total *= dimension;
+            }
+
+            if (dimensions.empty() || total != size) {
+                dimensions.assign(1, static_cast<hsize_t>(size));
+            }
+            return dimensions;
+        }
+
+        void createHDFDataset(const std::string& group_path, const std::string& dataset_name, const hid_t file_type, const std::size_t size, const std::size_t bytes) {
+            const hid_t group = getHDFGroup(group_path);
+
+            const std::vector<hsize_t> dimensions = getHDFDimensions(size);
+            const hid_t space = H5Screate_simple(static_cast<int>(dimensions.size()), dimensions.data(), nullptr);
+
+            hid_t create_property = H5P_DEFAULT;
+            if (bytes > 0 && bytes <= hdfCompactLimit) {
+                create_property = hdfCompactProperty;
+            } else if (hdfChunkSize > 0 || hdfDeflateLevel > 0) {
+                // chunks are split along the slowest dimension
+                std::vector<hsize_t> chunk = dimensions;
+                hsize_t inner = 1;
+                for(std::size_t i = 1; i < chunk.size(); ++i) inner *= chunk[i];
+                const hsize_t chunk_size = (hdfChunkSize > 0) ? static_cast<hsize_t>(hdfChunkSize) : hsize_t(1) << 16;
+                chunk[0] = std::max<hsize_t>(1, std::min<hsize_t>(dimensions[0], chunk_size / std::max<hsize_t>(inner, 1)));
+
+                create_property = H5Pcreate(H5P_DATASET_CREATE);
+                H5Pset_chunk(create_property, static_cast<int>(chunk.size()), chunk.data());
+                if (hdfShuffle) H5Pset_shuffle(create_property);
+                if (hdfDeflateLevel > 0) H5Pset_deflate(create_property, static_cast<unsigned>(hdfDeflateLevel));
+            }
+
+            hdfDataset = H5Dcreate2(group, dataset_name.c_str(), file_type, space, H5P_DEFAULT, create_property, H5P_DEFAULT);
+            if (create_property != H5P_DEFAULT && create_property != hdfCompactProperty) H5Pclose(create_property);
+            H5Sclose(space);
+
+            if (hdfDataset < 0) {
+                std::string error_message = "[SIMPLE XDMF ERROR] Failed to create the dataset " + group_path + "/" + dataset_name + " in " + hdfFileName + ".";
+                throw std::runtime_error(error_message);
+            }
+            hdfStaging.clear();
+        }
+
+        // values of the DataItem are written by endValues() unless they are added at once
+        template<typename T>
+        void beginHDFValues(const std::size_t size) {
+            if (buffer == "") {
+                std::string error_message = "[SIMPLE XDMF ERROR] Values of an HDF DataItem must be added by one add* function.";
+                throw std::runtime_error(error_message);
+            }
+
+            if (hdfFile < 0 && !dryRun) openHDFFile();
+
+            const std::size_t stored_size = getStoredSize<T>();
+            if (std::is_floating_point<T>::value && stored_size < 4) {
+                std::string error_message = "[SIMPLE XDMF ERROR] Floating point values cannot be stored with Precision = " + std::to_string(stored_size) + ".";
+                throw std::invalid_argument(error_message);
+            }
+
+            const std::string& endian = (dataItemEndian != "") ? dataItemEndian : heavyDataEndian;
+            const bool is_big_endian = (endian == "Big") || ((endian == "" || endian == "Native") && !isLittleEndianHost());
+            const hid_t file_type = getHDFType(std::is_floating_point<T>::value, isStoredSigned<T>(), stored_size, is_big_endian);
+
+            // unique dataset path, which skips datasets of previous documents in the same file
+            const auto split_index = elementPath.rfind('/');
+            const std::string group_path = elementPath.substr(0, split_index);
+            const std::string base_name = elementPath.substr(split_index + 1);
+            std::string dataset_name;
+            do {
+                const std::size_t count = hdfDatasetCounts[elementPath]++;
+                dataset_name = base_name;
+                if (count > 0) {
+                    dataset_name += '_';
+                    dataset_name += std::to_string(count);
+                }
+            } while (!dryRun && H5Lexists(getHDFGroup(group_path), dataset_name.c_str(), H5P_DEFAULT) > 0);
+            const std::size_t bytes = size * stored_size;
+            if (dryRun) {
+                dryRunPlan.hdfBytes += bytes;
+            } else {
+                createHDFDataset(group_path, dataset_name, file_type, size, bytes);
+            }
+
+            buffer += " NumberType=\"";
+            buffer += getNumberTypeString(std::is_floating_point<T>::value, isStoredSigned<T>(), stored_size);
+            buffer += "\" Precision=\"";
+            buffer += getPrecisionString(stored_size);
+            buffer += '"';
+
+            beginInnerElement();
+            buffer += hdfFileName;
+            buffer += ':';
+            buffer += group_path;
+            buffer += '/';
+            buffer += dataset_name;
+            buffer += newLine;
+            endInnerElement();
+        }
+
+        template<typename T>
+        void writeHDFValues(const T* values_ptr, const std::size_t count) {
+            // HDF5 converts the values into the stored type
+            const hid_t memory_type = getHDFMemoryType<T>(std::is_arithmetic<T>());
+            if (valuesWritten == 0 && count == valuesSize) {
+                checkHDFResult(H5Dwrite(hdfDataset, memory_type, H5S_ALL, H5S_ALL, H5P_DEFAULT, values_ptr), "write values");
+                return;
+            }
+
+            const char* bytes = reinterpret_cast<const char*>(values_ptr);
+            hdfStaging.insert(hdfStaging.end(), bytes, bytes + count * sizeof(T));
+            if (valuesWritten + count == valuesSize) {
+                checkHDFResult(H5Dwrite(hdfDataset, memory_type, H5S_ALL, H5S_ALL, H5P_DEFAULT, hdfStaging.data()), "write values");
+                hdfStaging.clear();
+            }
+        }
+
+        void endHDFValues() {
+            if (hdfDataset >= 0) H5Dclose(hdfDataset);
+            hdfDataset = -1;
+        }
+#endif
+
+        // Sparse attributes
+        // Active entries are compacted in two branch-free passes so that compiler can vectorize them:
+        // the first counts them, and the second writes every entry and advances only over active ones.
+        template<typename T, typename Index, typename Mask>
+        static void compactActiveValues(const T* values_ptr, const Mask& mask, const std::size_t size, const std::size_t components,
+                                        std::vector<Index>& indices, std::vector<T>& values) {
+            std::size_t count = 0;
+            for(std::size_t i = 0; i < size; ++i) {
+                count += (mask[i] != 0) ? 1 : 0;
+            }
+
+            // one extra entry receives the writes of the trailing inactive entries
+            indices.resize(count + 1);
+            values.resize((count + 1) * components);
+
+            std::size_t k = 0;
+            if (components == 1) {
+                for(std::size_t i = 0; i < size; ++i) {
+                    indices[k] = static_cast<Index>(i);
+                    values[k] = values_ptr[i];
+                    k += (mask[i] != 0) ? 1 : 0;
+                }
+            } else {
+                for(std::size_t i = 0; i < size; ++i) {
+                    indices[k] = static_cast<Index>(i);
+                    std::copy(values_ptr + i * components, values_ptr + (i + 1) * components, values.data() + k * components);
+                    k += (mask[i] != 0) ? 1 : 0;
+                }
+            }
+
+            indices.resize(count);
+            values.resize(count * components);
+        }
+
+        template<typename T, typename Index>
+        void writeSparseAttribute(const std::string& name, const std::vector<Index>& indices, const std::vector<T>& values,
+                                  const std::size_t components, const std::string& center, const std::string& format) {
+            auto begin_data_item = [this, &format](const char* number_type, const std::size_t size) {
+                beginDataItem();
+                setFormat(format);
+                if (format == "XML") {
+                    setNumberType(number_type);
+                    setPrecision(getPrecisionString(size));
+                }
+            };
+
+            const std::size_t count = indices.size();
+            const std::string type = getAttributeTypeString(components);
+
+            beginSet(name, center);
+                begin_data_item(getNumberTypeString<Index>(), sizeof(Index));
+                    setDimensions(count);
+                    addVector(indices);
+                endDataItem();
+
+                beginAttribute(name, type);
+                    setCenter(center);
+                    begin_data_item(getNumberTypeString<T>(), sizeof(T));
+                        if (components == 1) {
+                            setDimensions(count);
+                        } else {
+                            setDimensions(components, count);
+                        }
+                        addVector(values);
+                    endDataItem();
+                endAttribute();
+            endSet();
+        }
+
+        template<typename T, typename Mask>
+        void addSparseAttributeValues(const std::string& name, const T* values_ptr, const Mask& mask, const std::size_t size,
+                                      const std::size_t components, const std::string& center, const std::string& format) {
+            std::vector<T> values;
+            if (size <= std::numeric_limits<std::uint32_t>::max()) {
+                std::vector<std::uint32_t> indices;
+                compactActiveValues(values_ptr, mask, size, components, indices, values);
+                writeSparseAttribute(name, indices, values, components, center, format);
+            } else {
+                std::vector<std::uint64_t> indices;
+                compactActiveValues(values_ptr, mask, size, components, indices, values);
+                writeSparseAttribute(name, indices, values, components, center, format);
+            }
+        }
+
+        // AttributeType of an Attribute of the given number of components
+        static std::string getAttributeTypeString(const std::size_t components) {
+            return (components == 3) ? "Vector" : ((components == 6) ? "Tensor6" : ((components == 9) ? "Tensor" : "Scalar"));
+        }
+
+        // Batched attributes
+        // Items are visited in blocks of about batchedBlockBytes of the widest field, and block k of every field
+        // is gathered and encoded before block k + 1. Fields interleaved in one array of cells are read in one pass
+        // over it, instead of one pass per field.
+        enum : std::size_t { batchedBlockBytes = 1 << 18 };
+
+        template<typename T>
+        static std::size_t getFieldStride(const AttributeField<T>& field) {
+            return (field.stride != 0) ? field.stride : field.components * sizeof(T);
+        }
+
+        template<typename T>
+        static void gatherFieldValues(T* dst, const AttributeField<T>& field, const std::size_t begin, const std::size_t end) {
+            const std::size_t stride = getFieldStride(field);
+            const char* src = reinterpret_cast<const char*>(field.values) + begin * stride;
+
+            for(std::size_t i = begin; i < end; ++i, src += stride) {
+                const T* item = reinterpret_cast<const T*>(src);
+                for(std::size_t c = 0; c < field.components; ++c) {
+                    *dst++ = item[c];
+                }
+            }
+        }
+
+        template<typename T>
+        void addBatchedAttributes(const std::vector<AttributeField<T>>& fields, const std::size_t size, const std::string& center, const std::string& format) {
+            const bool is_binary = (format == "Binary");
+
+            std::size_t max_stride = 1;
+            std::size_t max_components = 1;
+            for(const auto& field : fields) {
+                max_stride = std::max(max_stride, getFieldStride(field));
+                max_components = std::max(max_components, field.components);
+            }
+            const std::size_t block_items = std::max<std::size_t>(64, batchedBlockBytes / max_stride);
+
+            // values are placed two levels below the current element
+            const std::size_t per_line = std::max(1u, innerElementPerLine);
+            std::string line_break = newLine;
+            for(unsigned int i = 0; i < currentIndentation + 3; ++i) line_break += indent;
+
+            std::vector<HeavyDataBlock> ranges(fields.size());
+            std::vector<std::string> texts(fields.size());
+            for(std::size_t f = 0; f < fields.size(); ++f) {
+                if (is_binary) ranges[f] = allocateHeavyData<T>(size * fields[f].components);
+            }
+
+            std::vector<T> staging(std::min(block_items, size) * max_components);
+            for(std::size_t begin = 0; begin < size; begin += block_items) {
+                const std::size_t end = std::min(size, begin + block_items);
+
+                for(std::size_t f = 0; f < fields.size(); ++f) {
+                    const auto& field = fields[f];
+                    const std::size_t first = begin * field.components;
+                    const std::size_t count = (end - begin) * field.components;
+
+                    const T* block_values = field.values + first;
+                    if (getFieldStride(field) != field.components * sizeof(T)) {
+                        gatherFieldValues(staging.data(), field, begin, end);
+                        block_values = staging.data();
+                    }
+
+                    if (is_binary) {
+                        HeavyDataBlock part;
+                        part.offset = ranges[f].offset + first * sizeof(T);
+                        part.size = count;
+                        part.valueSize = sizeof(T);
+                        writeHeavyData(part, block_values);
+                        continue;
+                    }
+
+                    const std::size_t total = size * field.components;
+                    for(std::size_t n = 0; n < count; ++n) {
+                        const std::size_t i = first + n + 1;
+                        appendValue(texts[f], block_values[n]);
+
+                        if (i < total) {
+                            texts[f] += ' ';
+                            if (i % per_line == 0) texts[f] += line_break;
+                        }
+                    }
+                }
+            }
+
+            for(std::size_t f = 0; f < fields.size(); ++f) {
+                const auto& field = fields[f];
+                const std::size_t total = size * field.components;
+
+                beginAttribute(field.name, getAttributeTypeString(field.components));
+                    setCenter(center);
+                    beginDataItem();
+                        if (field.components == 1) {
+                            setDimensions(size);
+                        } else {
+                            setDimensions(field.components, size);
+                        }
+
+                        setFormat(is_binary ? "Binary" : "XML");
+
+                        // the values are visited again only for the statistics of this DataItem
+                        if (statisticsEnabled) {
+                            const char* items = reinterpret_cast<const char*>(field.values);
+                            const std::size_t stride = getFieldStride(field);
+                            for(std::size_t i = 0; i < size; ++i) {
+                                accumulateStatistics(reinterpret_cast<const T*>(items + i * stride), field.components);
+                            }
+                        }
+
+                        if (is_binary) {
+                            addHeavyDataBlock<T>(ranges[f]);
+                        } else {
+                            setNumberType(getNumberTypeString<T>());
+                            setPrecision(getPrecisionString(sizeof(T)));
+
+                            beginValues<T>(total);
+                            commitInnerBuffer();
+                            content += texts[f];
+                            std::string().swap(texts[f]);
+                            flushContentIfNeeded();
+                            valuesWritten = total;
+                            endValues();
+                        }
+                    endDataItem();
+                endAttribute();
+            }
+        }
+
+        // Call function(begin, end) for up to thread_count contiguous ranges of [0, count), the first one on the calling thread.
+        // An exception thrown by any range is rethrown after all threads are joined.
+        template<typename F>
+        static void runInParallel(const std::size_t count, const unsigned int thread_count, F&& function) {
+            const std::size_t threads_used = std::max<std::size_t>(std::min<std::size_t>(thread_count, count), 1);
+            const std::size_t chunk = (count + threads_used - 1) / threads_used;
+
+            std::vector<std::exception_ptr> errors(threads_used);
+            auto run = [&](const std::size_t t) {
+                try {
+                    const std::size_t begin = std::min(count, t * chunk);
+                    function(begin, std::min(count, begin + chunk));
+                } catch (...) {
+                    errors[t] = std::current_exception();
+                }
+            };
+
+            std::vector<std::thread> threads;
+            try {
+                for(std::size_t t = 1; t < threads_used; ++t) threads.emplace_back(run, t);
+            } catch (...) {
+                for(auto& thread : threads) thread.join();
+                throw;
+            }
+            run(0);
+            for(auto& thread : threads) thread.join();
+            for(const auto& error : errors) {
+                if (error) std::rethrow_exception(error);
+            }
+        }
+
+        // Preview levels
+        // Each level halves the resolution of the previous one by averaging the values in boxes along every axis
+        // with more than one point, one axis after another. Along y and z, rows of x are accumulated at once so that
+        // compiler can vectorize the inner loop, and the rows of every pass are shared by thread_count threads.
+        // An even number of points leaves the last box half full, so the coarse grid is padded by one fine spacing
+        // and still covers the whole domain.
+        static std::size_t getPreviewPointCount(const std::size_t points) {
+            return points / 2 + 1;
+        }
+
+        // points are the numbers of points of the grid, which are halved by getPreviewPointCount()
+        template<typename T>
+        static std::vector<T> downsamplePreviewValues(const T* values_ptr, std::array<std::size_t, 3> points, const bool is_cell, const unsigned int thread_count) {
+            using Sum = typename std::conditional<std::is_floating_point<T>::value, T, double>::type;
+
+            std::vector<T> in;
+            const T* in_ptr = values_ptr;
+            for(std::size_t axis = 0; axis < 3; ++axis) {
+                if (points[axis] < 3) continue;
+
+                // counts of values along each axis before and after this pass
+                std::array<std::size_t, 3> counts;
+                for(std::size_t a = 0; a < 3; ++a) counts[a] = is_cell ? std::max<std::size_t>(points[a], 2) - 1 : points[a];
+                const std::size_t n = counts[axis];
+                const std::size_t coarse_points = getPreviewPointCount(points[axis]);
+                const std::size_t m = is_cell ? coarse_points - 1 : coarse_points;
+
+                std::size_t inner = 1;
+                for(std::size_t a = 0; a < axis; ++a) inner *= counts[a];
+                std::size_t outer = 1;
+                for(std::size_t a = axis + 1; a < 3; ++a) outer *= counts[a];
+
+                std::vector<T> out(inner * m * outer);
+
+                runInParallel(outer * m, thread_count, [&](const std::size_t begin, const std::size_t end) {
+                    // along x, values of a window are contiguous
+                    if (inner == 1) {
+                        for(std::size_t r = begin; r < end; ++r) {
+                            const std::size_t o = r / m;
+                            const std::size_t j = r % m;
+                            const std::size_t lo = is_cell ? 2 * j : std::max<std::size_t>(2 * j, 1) - 1;
+                            const std::size_t hi = std::min(2 * j + 1, n - 1);
+
+                            Sum total = Sum(0);
+                            for(std::size_t w = lo; w <= hi; ++w) total += static_cast<Sum>(in_ptr[o * n + w]);
+                            out[r] = static_cast<T>(total / static_cast<Sum>(hi - lo + 1));
+                        }
+                        return;
+                    }
+
+                    std::vector<Sum> row(inner);
+                    for(std::size_t r = begin; r < end; ++r) {
+                        const std::size_t o = r / m;
+                        const std::size_t j = r % m;
+
+                        // a cell covers 2 cells of the previous level, and a point averages its neighbours,
+                        // and the last box is clamped to the values of the padded grid
+                        const std::size_t lo = is_cell ? 2 * j : std::max<std::size_t>(2 * j, 1) - 1;
+                        const std::size_t hi = std::min(2 * j + 1, n - 1);
+
+                        std::fill(row.begin(), row.end(), Sum(0));
+                        for(std::size_t w = lo; w <= hi; ++w) {
+                            const T* src = in_ptr + (o * n + w) * inner;
+                            for(std::size_t i = 0; i < inner; ++i) row[i] += static_cast<Sum>(src[i]);
+                        }
+
+                        const Sum scale = Sum(1) / static_cast<Sum>(hi - lo + 1);
+                        T* dst = out.data() + (o * m + j) * inner;
+                        for(std::size_t i = 0; i < inner; ++i) dst[i] = static_cast<T>(row[i] * scale);
+                    }
+                });
+
+                in.swap(out);
+                in_ptr = in.data();
+                points[axis] = coarse_points;
+            }
+
+            return in;
+        }
+
+        template<typename T>
+        void addPreviewLevels(const std::string& name, std::array<std::size_t, 3> points, const std::array<double, 3>& origin, std::array<double, 3> spacing,
+                              const std::vector<PreviewField<T>>& fields, const std::string& format, const unsigned int levels, unsigned int thread_count) {
+            const bool is_2d = (points[2] == 1);
+            for(const auto& field : fields) {
+                if (field.center != "Cell" && field.center != "Node") {
+                    std::string error_message = "[SIMPLE XDMF ERROR] Invalid Center type = " + field.center + " is passed to a preview level.";
+                    throw std::invalid_argument(error_message);
+                }
+            }
+
+            if (thread_count == 0) thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+            std::vector<std::vector<T>> values(fields.size());
+            for(unsigned int level = 1; level <= levels; ++level) {
+                bool can_halve = true;
+                for(const std::size_t n : points) {
+                    if (n > 1 && n < 3) can_halve = false;
+                }
+                if (!can_halve) break;
+
+                for(std::size_t f = 0; f < fields.size(); ++f) {
+                    const bool is_cell = (fields[f].center == "Cell");
+                    values[f] = downsamplePreviewValues((level == 1) ? fields[f].values : values[f].data(), points, is_cell, thread_count);
+                }
+
+                for(std::size_t a = 0; a < 3; ++a) {
+                    if (points[a] > 1) {
+                        points[a] = getPreviewPointCount(points[a]);
+                        spacing[a] *= 2.0;
+                    }
+                }
+
+                const std::string grid_name = name + "_x" + std::to_string(1u << level);
+                if (is_2d) {
+                    begin2DStructuredGrid(grid_name, "2DCoRectMesh", points[0], points[1]);
+                    add2DGeometryOrigin("", origin[0], origin[1], spacing[0], spacing[1]);
+                } else {
+                    begin3DStructuredGrid(grid_name, "3DCoRectMesh", points[0], points[1], points[2]);
+                    add3DGeometryOrigin("", origin[0], origin[1], origin[2], spacing[0], spacing[1], spacing[2]);
+                }
+
+                for(std::size_t f = 0; f < fields.size(); ++f) {
+                    const std::size_t offset = (fields[f].center == "Cell") ? 1 : 0;
+                    beginAttribute(fields[f].name);
+                        setCenter(fields[f].center);
+                        beginDataItem();
+                            if (is_2d) {
+                                setDimensions(points[0] - offset, points[1] - offset);
+                            } else {
+                                setDimensions(points[0] - offset, points[1] - offset, points[2] - offset);
+                            }
+                            setFormat(format);
+                            addVector(values[f]);
+                        endDataItem();
+                    endAttribute();
+                }
+
+                if (is_2d) {
+                    end2DStructuredGrid();
+                } else {
+                    end3DStructuredGrid();
+                }
+            }
+        }
+
+        // AMR hierarchy
+        static std::size_t getAMRValueCount(const AMRBlock& block, const std::string& center) {
+            std::size_t count = 1;
+            for(const std::size_t extent : block.extents) {
+                count *= (center == "Cell") ? std::max<std::size_t>(extent, 2) - 1 : extent;
+            }
+            return count;
+        }
+
+        // the same text as begin3DStructuredGrid(), add3DGeometryOrigin() and Binary Attributes
+        template<typename T>
+        void renderAMRBlock(std::string& out, const unsigned int depth, const std::size_t index, const AMRBlock& block,
+                            const std::vector<AMRField<T>>& fields, const std::vector<std::uint64_t>& seeks) const {
+            auto begin_line = [this, &out](const unsigned int level) {
+                for(unsigned int i = 0; i < level; ++i) out += indent;
+            };
+
+            begin_line(depth);
+            out += "<Grid GridType=\"Uniform\" Name=\"Block";
+            appendValue(out, index);
+            out += "\">";
+            out += newLine;
+
+            begin_line(depth + 1);
+            out += "<Topology TopologyType=\"3DCoRectMesh\" NumberOfElements=\"";
+            appendReversedArgs(out, block.extents[0], block.extents[1], block.extents[2]);
+            out += "\"/>";
+            out += newLine;
+
+            begin_line(depth + 1);
+            out += "<Geometry GeometryType=\"ORIGIN_DXDYDZ\">";
+            out += newLine;
+            for(const auto* values : {&block.origin, &block.spacing}) {
+                begin_line(depth + 2);
+                out += "<DataItem ItemType=\"Uniform\" Dimensions=\"3\" Format=\"XML\">";
+                out += newLine;
+                begin_line(depth + 3);
+                appendReversedArgs(out, (*values)[0], (*values)[1], (*values)[2]);
+                out += newLine;
+                begin_line(depth + 2);
+                out += "</DataItem>";
+                out += newLine;
+            }
+            begin_line(depth + 1);
+            out += "</Geometry>";
+            out += newLine;
+
+            for(std::size_t f = 0; f < fields.size(); ++f) {
+                const bool is_cell = (fields[f].center == "Cell");
+
+                begin_line(depth + 1);
+                out += "<Attribute AttributeType=\"Scalar\" Name=\"";
+                out += fields[f].name;
+                out += "\" Center=\"";
+                out += fields[f].center;
+                out += "\">";
+                out += newLine;
+
+                begin_line(depth + 2);
+                out += "<DataItem ItemType=\"Uniform\" Dimensions=\"";
+                appendReversedArgs(out,
+                                   is_cell ? std::max<std::size_t>(block.extents[0], 2) - 1 : block.extents[0],
+                                   is_cell ? std::max<std::size_t>(block.extents[1], 2) - 1 : block.extents[1],
+                                   is_cell ? std::max<std::size_t>(block.extents[2], 2) - 1 : block.extents[2]);
+                out += "\" Format=\"Binary\" NumberType=\"";
+                out += getNumberTypeString<T>();
+                out += "\" Precision=\"";
+                out += getPrecisionString(sizeof(T));
+                out += "\" Seek=\"";
+                appendValue(out, seeks[f * (seeks.size() / fields.size()) + index]);
+                out += "\">";
+                out += newLine;
+
+                begin_line(depth + 3);
+                out += heavyDataFileName;
+                out += newLine;
+                begin_line(depth + 2);
+                out += "</DataItem>";
+                out += newLine;
+
+                begin_line(depth + 1);
+                out += "</Attribute>";
+                out += newLine;
+            }
+
+            begin_line(depth);
+            out += "</Grid>";
+            out += newLine;
+        }
+
+        // Binary DataItem of count items of components values, returning its Seek
+        template<typename T>
+        std::uint64_t addParticleDataItem(const T* values, const std::size_t count, const std::size_t components) {
+            beginDataItem();
+                if (components == 1) {
+                    setDimensions(count);
+                } else {
+                    setDimensions(components, count);
+                }
+                setFormat("Binary");
+                addArray(values, count * components);
+
+                // the values end at the cursor, in the stored type which may be narrowed
+                const std::uint64_t seek = heavyDataCursor - static_cast<std::uint64_t>(count * components) * getStoredSize<T>();
+            endDataItem();
+            return seek;
+        }
+
+        // NumberType, Precision, Endian and Seek of the current Binary DataItem
+        template<typename T>
+        void appendBinaryAttributes(const std::uint64_t seek) {
+            const std::size_t stored_size = getStoredSize<T>();
+
+            buffer += " NumberType=\"";
+            buffer += getNumberTypeString(std::is_floating_point<T>::value, isStoredSigned<T>(), stored_size);
+            buffer += "\" Precision=\"";
+            buffer += getPrecisionString(stored_size);
+            buffer += '"';
+            const std::string& endian = (dataItemEndian != "") ? dataItemEndian : heavyDataEndian;
+            if (endian != "") appendAttribute("Endian", endian);
+            buffer += " Seek=\"";
+            appendValue(buffer, seek);
+            buffer += '"';
+
+            beginInnerElement();
+            buffer += heavyDataFileName;
+            buffer += newLine;
+            endInnerElement();
+        }
+
+        template<typename T, typename S>
+        void writeConvertedValues(const T* values_ptr, const std::size_t count, const bool collect_statistics) {
+            constexpr std::size_t chunkSize = 4096;
+            S chunk[chunkSize];
+
+            for(std::size_t begin = 0; begin < count; begin += chunkSize) {
+                const std::size_t n = std::min(chunkSize, count - begin);
+                const T* src = values_ptr + begin;
+                if (collect_statistics) accumulateStatistics(src, n);
+
+                if (!storedRangeChecked) checkStoredRange<S>(src, n, std::is_integral<T>());
+
+                for(std::size_t i = 0; i < n; ++i) {
+                    chunk[i] = static_cast<S>(src[i]);
+                }
+
+                if (swapBytes) byteSwapValues(chunk, n);
+
+                writeHeavyData(chunk, n * sizeof(S));
+            }
+        }
+
+        template<typename T, bool Signed>
+        void writeBinaryValuesAs(const T* values_ptr, const std::size_t count, const bool collect_statistics) {
+            switch (getStoredSize<T>()) {
+                case 1:
+                    writeConvertedValues<T, StoredType<T, 1, Signed>>(values_ptr, count, collect_statistics);
+                    break;
+                case 2:
+                    writeConvertedValues<T, StoredType<T, 2, Signed>>(values_ptr, count, collect_statistics);
+                    break;
+                case 4:
+                    writeConvertedValues<T, StoredType<T, 4, Signed>>(values_ptr, count, collect_statistics);
+                    break;
+                default:
+                    writeConvertedValues<T, StoredType<T, 8, Signed>>(values_ptr, count, collect_statistics);
+                    break;
+            }
+        }
+
+        template<typename T>
+        void writeBinaryValues(const T* values_ptr, const std::size_t count, const bool collect_statistics, std::true_type) {
+            if (isStoredSigned<T>()) {
+                writeBinaryValuesAs<T, true>(values_ptr, count, collect_statistics);
+            } else {
+                writeBinaryValuesAs<T, false>(values_ptr, count, collect_statistics);
+            }
+        }
+
+        // non arithmetic values are written as they are
+        template<typename T>
+        void writeBinaryValues(const T* values_ptr, const std::size_t count, const bool, std::false_type) {
+            writeHeavyData(values_ptr, count * sizeof(T));
+        }
+
+        bool checkIsValidEndian(const std::string& endian, const std::string& function_name) {
+            if (endian != "Native" && endian != "Big" && endian != "Little") {
+                std::string error_message = "[SIMPLE XDMF ERROR] Invalid Endian = " + endian + " is passed to " + function_name + ".";
+                throw std::invalid_argument(error_message);
+            }
+            return true;
+        }
+
+        template<typename T>
+        bool isStoredSigned() const {
+            return std::is_signed<T>::value && !storedUnsigned;
+        }
+
+        // Integer values are checked against the stored type before the add*() function allocates or writes anything,
+        // so that an overflow leaves neither a partial payload nor a Seek attribute in the output.
+        template<typename T, bool Signed>
+        void checkStoredValuesAs(const T* values_ptr, const std::size_t count) const {
+            switch (getStoredSize<T>()) {
+                case 1:
+                    checkStoredRange<StoredType<T, 1, Signed>>(values_ptr, count, std::true_type());
+                    break;
+                case 2:
+                    checkStoredRange<StoredType<T, 2, Signed>>(values_ptr, count, std::true_type());
+                    break;
+                case 4:
+                    checkStoredRange<StoredType<T, 4, Signed>>(values_ptr, count, std::true_type());
+                    break;
+                default:
+                    checkStoredRange<StoredType<T, 8, Signed>>(values_ptr, count, std::true_type());
+                    break;
+            }
+        }
+
+        template<typename T>
+        void checkStoredValues(const T* values_ptr, const std::size_t count, std::true_type) {
+            if (!isBinaryDataItem || (getStoredSize<T>() == sizeof(T) && isStoredSigned<T>() == std::is_signed<T>::value)) return;
+
+            if (isStoredSigned<T>()) {
+                checkStoredValuesAs<T, true>(values_ptr, count);
+            } else {
+                checkStoredValuesAs<T, false>(values_ptr, count);
+            }
+        }
+
+        template<typename T>
+        void checkStoredValues(const T*, const std::size_t, std::false_type) {}
+
+        template<typename T>
+        void checkStoredValues(const T* values_ptr, const std::size_t count) {
+            checkStoredValues(values_ptr, count, std::is_integral<T>());
+        }
+
+        // Integer narrowing
+        // The range of integer values is computed in one pass, and the values are stored
+        // with the smallest NumberType and Precision which can represent them.
+        template<typename T>
+        void narrowIntegers(const T* values_ptr, const std::size_t size, std::true_type) {
+            if (sizeof(T) == 1 || size == 0) return;
+
+            T min_v = std::numeric_limits<T>::max();
+            T max_v = std::numeric_limits<T>::lowest();
+            for(std::size_t i = 0; i < size; ++i) {
+                min_v = (values_ptr[i] < min_v) ? values_ptr[i] : min_v;
+                max_v = (values_ptr[i] > max_v) ? values_ptr[i] : max_v;
+            }
+
+            const bool is_unsigned = !isNegative(min_v, std::is_signed<T>());
+            for(std::size_t bytes = 1; bytes < sizeof(T); bytes *= 2) {
+                const unsigned bits = static_cast<unsigned>(bytes * 8);
+                bool fits;
+                if (is_unsigned) {
+                    fits = static_cast<std::uint64_t>(max_v) <= (std::uint64_t(1) << bits) - 1;
+                } else {
+                    const std::int64_t limit = std::int64_t(1) << (bits - 1);
+                    fits = static_cast<std::int64_t>(min_v) >= -limit && static_cast<std::int64_t>(max_v) <= limit - 1;
+                }
+
+                if (fits) {
+                    storedPrecision = bytes;
+                    storedUnsigned = is_unsigned;
+                    return;
+                }
+            }
+        }
+
+        template<typename T>
+        void narrowIntegers(const T*, const std::size_t, std::false_type) {}
+
+        template<typename T>
+        std::size_t getStoredSize() const {
+            return (storedPrecision > 0 && std::is_arithmetic<T>::value) ? storedPrecision : sizeof(T);
+        }
+
+        // Statistics
+        void resetStatistics() {
+            hasStatistics = false;
+            statisticsSum = 0.0;
+            statistics = DataStatistics();
+            statistics.min = std::numeric_limits<double>::max();
+            statistics.max = -std::numeric_limits<double>::max();
+        }
+
+        void updateStatistics(const double v) {
+            const bool is_nan = (v != v);
+            const bool is_finite = std::abs(v) <= std::numeric_limits<double>::max();
+
+            statistics.nanCount += is_nan;
+            statistics.infCount += (!is_nan && !is_finite);
+            statistics.count += 1;
+            statisticsSum += is_finite ? v : 0.0;
+            statistics.min = (is_finite && v < statistics.min) ? v : statistics.min;
+            statistics.max = (is_finite && v > statistics.max) ? v : statistics.max;
+        }
+
+        template<typename T>
+        void updateStatistics(const T& value, std::true_type) {
+            updateStatistics(static_cast<double>(value));
+        }
+
+        template<typename T>
+        void updateStatistics(const T&, std::false_type) {}
+
+        template<typename T>
+        void accumulateStatistics(const T* values_ptr, const std::size_t count) {
+            hasStatistics = true;
+            for(std::size_t i = 0; i < count; ++i) {
+                updateStatistics(values_ptr[i], std::is_arithmetic<T>());
+            }
+        }
+
+        static std::string formatExactValue(const double value) {
+            std::stringstream ss;
+            ss << std::setprecision(std::numeric_limits<double>::max_digits10) << value;
+            return ss.str();
+        }
+
+        // Information elements are placed in the element enclosing the DataItem
+        void commitStatistics() {
+            const std::size_t finite_count = statistics.count - statistics.nanCount - statistics.infCount;
+            if (finite_count > 0) {
+                statistics.mean = statisticsSum / static_cast<double>(finite_count);
+            } else {
+                statistics.min = 0.0;
+                statistics.max = 0.0;
+            }
+            hasStatistics = false;
+            lastStatistics = statistics;
+
+            const std::array<std::pair<const char*, std::string>, 5> informations {{
+                {"Min", formatExactValue(statistics.min)},
+                {"Max", formatExactValue(statistics.max)},
+                {"Mean", formatExactValue(statistics.mean)},
+                {"NaNCount", std::to_string(statistics.nanCount)},
+                {"InfCount", std::to_string(statistics.infCount)}
+            }};
+
+            // the Names are not registered, so that they never shadow Names of the user
+            for(const auto& info : informations) {
+                beginElement(TAG::Information);
+                appendAttribute("Name", info.first);
+                setValue(info.second);
+                endInformation();
+            }
+
+            if (statisticsCallback) {
+                statisticsCallback(statistics);
+            }
+        }
+
+        template<typename T>
+        void beginValues(const std::size_t size) {
+            valuesWritten = 0;
+            valuesSize = size;
+
+#ifdef USE_HDF5
+            if (isHDFDataItem) {
+                beginHDFValues<T>(size);
+                return;
+            }
+#endif
+
+            if (isBinaryDataItem) {
+                if (heavyDataFileName == "") {
+                    std::string error_message = "[SIMPLE XDMF ERROR] setHeavyDataFile() must be called before adding values to a Binary DataItem.";
+                    throw std::runtime_error(error_message);
+                }
+
+                if (!dryRun) prepareHeavyDataOutput();
+
+                const std::size_t stored_size = getStoredSize<T>();
+                if (std::is_floating_point<T>::value && stored_size < 4) {
+                    std::string error_message = "[SIMPLE XDMF ERROR] Floating point values cannot be stored with Precision = " + std::to_string(stored_size) + ".";
+                    throw std::invalid_argument(error_message);
+                }
+
+                // values of following add*() calls are stored just after the first one
+                const bool is_continued = (buffer == "");
+                allocateValues(static_cast<std::uint64_t>(size) * stored_size, is_continued);
+                if (is_continued) return;
+
+                const std::string& endian = (dataItemEndian != "") ? dataItemEndian : heavyDataEndian;
+                swapBytes = (endian == "Big" && isLittleEndianHost()) || (endian == "Little" && !isLittleEndianHost());
+
+                appendBinaryAttributes<T>(heavyDataCursor);
+                return;
+            }
+
+            beginInnerElement();
+        }
+
+        template<typename T>
+        void writeValues(const T* values_ptr, const std::size_t count) {
+            // quantized values are accounted from the original values
+            const bool collect_statistics = statisticsEnabled && !isQuantizedDataItem && std::is_arithmetic<T>::value;
+            if (collect_statistics) hasStatistics = true;
+
+#ifdef USE_HDF5
+            if (isHDFDataItem) {
+                if (collect_statistics) accumulateStatistics(values_ptr, count);
+                if (!dryRun) writeHDFValues(values_ptr, count);
+                valuesWritten += count;
+                return;
+            }
+#endif
+
+            if (dryRun) {
+                measureValues(values_ptr, count, collect_statistics);
+                return;
+            }
+
+            if (isBinaryDataItem && (getStoredSize<T>() != sizeof(T) || swapBytes)) {
+                writeBinaryValues(values_ptr, count, collect_statistics, std::is_arithmetic<T>());
+                valuesWritten += count;
+                return;
+            }
+
+            if (isBinaryDataItem) {
+                // statistics are computed chunk by chunk just before the chunk is written
+                constexpr std::size_t chunkSize = 4096;
+                const std::size_t step = collect_statistics ? chunkSize : count;
+
+                for(std::size_t begin = 0; begin < count; begin += step) {
+                    const std::size_t n = std::min(step, count - begin);
+                    if (collect_statistics) accumulateStatistics(values_ptr + begin, n);
+
+                    writeHeavyData(values_ptr + begin, n * sizeof(T));
+                }
+
+                valuesWritten += count;
+                return;
+            }
+
+            for(std::size_t n = 0; n < count; ++n) {
+                const std::size_t i = ++valuesWritten;
+                appendValue(buffer, values_ptr[n]);
+                if (collect_statistics) updateStatistics(values_ptr[n], std::is_arithmetic<T>());
+
+                if (i < valuesSize) {
+                    buffer += ' ';
+
+                    if (i % innerElementPerLine == 0) {
+                        buffer += newLine;
+
+                        // keep memory bounded in durable output mode
+                        if (durableFile != nullptr && buffer.size() >= durableFlushInterval) {
+                            commitInnerBuffer();
+                        }
+
+                        insertIndent();
+                    }
+                }
+            }
+        }
+
+        // Dry run
+        // Binary values only advance the heavy data cursor. Text values are not formatted,
+        // and the widest text of their type is accounted instead.
+        template<typename T>
+        static typename std::enable_if<std::is_integral<T>::value, std::size_t>::type getMaxTextSize(const T&) {
+            return static_cast<std::size_t>(std::numeric_limits<T>::digits10) + 2;
+        }
+
+        // %g prints at most 6 digits, a sign, a point and an exponent
+        template<typename T>
+        static typename std::enable_if<std::is_floating_point<T>::value, std::size_t>::type getMaxTextSize(const T&) {
+            return 14;
+        }
+
+        template<typename T>
+        static typename std::enable_if<!std::is_arithmetic<T>::value, std::size_t>::type getMaxTextSize(const T& value) {
+            std::string text;
+            appendValue(text, value);
+            return text.size();
+        }
+
+        template<typename T>
+        void measureValues(const T* values_ptr, const std::size_t count, const bool collect_statistics) {
+            if (collect_statistics) accumulateStatistics(values_ptr, count);
+
+            if (isBinaryDataItem) {
+                heavyDataCursor += static_cast<std::uint64_t>(count) * getStoredSize<T>();
+                valuesWritten += count;
+                return;
+            }
+
+            const std::size_t line_bytes = newLine.size() + indent.size() * currentIndentation;
+            for(std::size_t n = 0; n < count; ++n) {
+                const std::size_t i = ++valuesWritten;
+                std::size_t bytes = getMaxTextSize(values_ptr[n]);
+                if (i < valuesSize) {
+                    bytes += 1;
+                    if (i % innerElementPerLine == 0) bytes += line_bytes;
+                }
+                dryRunPlan.documentBytes += bytes;
+            }
+            dryRunPlan.isExact = false;
+        }
+
+        void endValues() {
+            storedRangeChecked = false;
+#ifdef USE_HDF5
+            if (isHDFDataItem) {
+                endHDFValues();
+                return;
+            }
+#endif
+            if (isBinaryDataItem) return;
+
+            if (valuesSize > 0) {
+                buffer += newLine;
+            }
+
+            endInnerElement();
+        }
+
+        // Layout conversion
+        // Writes a rows x cols row-major matrix in column-major (XDMF) order.
+        // row_pointer(r) returns the pointer to the contiguous r-th row.
+        // A strip of columns is gathered into a staging buffer, reading each row contiguously
+        // and writing at most maxColumns sequential streams, and then written at once.
+        template<typename T, typename RowPointer>
+        void writeTransposedValues(const std::size_t rows, const std::size_t cols, RowPointer&& row_pointer) {
+            constexpr std::size_t maxColumns = 64;
+            constexpr std::size_t stagingSize = 1 << 20;
+
+            if (rows == 0 || cols == 0) return;
+
+            const std::size_t block = std::max<std::size_t>(1, std::min<std::size_t>(maxColumns, stagingSize / rows));
+            std::vector<typename std::remove_const<T>::type> staging(std::min(block, cols) * rows);
+
+            for(std::size_t col_begin = 0; col_begin < cols; col_begin += block) {
+                const std::size_t block_cols = std::min(block, cols - col_begin);
+                auto* const dst = staging.data();
+
+                for(std::size_t r = 0; r < rows; ++r) {
+                    const T* const row = row_pointer(r) + col_begin;
+                    for(std::size_t c = 0; c < block_cols; ++c) {
+                        dst[c * rows + r] = row[c];
+                    }
+                }
+
+                writeValues(staging.data(), block_cols * rows);
+            }
+        }
+
+        // values_kept = false for values which do not outlive the call, which are never deferred
+        template<typename T>
+        void addValues(const T* values_ptr, const std::size_t size, const bool values_kept = true) {
+            if (quantizationBits > 0 && std::is_floating_point<T>::value) {
+                addQuantizedValues(values_ptr, size, values_kept);
+                return;
+            }
+
+            // the first values of a Binary DataItem decide its stored type
+            if (integerNarrowing && (isBinaryDataItem || isHDFDataItem) && storedPrecision == 0 && buffer != "") {
+                narrowIntegers(values_ptr, size, std::integral_constant<bool, std::is_integral<T>::value && !std::is_same<T, bool>::value>());
+            }
+
+            checkStoredValues(values_ptr, size);
+            storedRangeChecked = true;
+
+            beginValues<T>(size);
+            if (values_kept && canDeferValues<T>(size)) {
+                deferValues(values_ptr, size);
+            } else {
+                writeValues(values_ptr, size);
+            }
+            endValues();
+        }
+
+        // Values given as rows of a row-major layout (add2DArray(), add3DArray() and addMultiArray()).
+        // Quantization and integer narrowing need all values at once, so the values are then gathered in XDMF order
+        // and passed to addValues(). Otherwise they are transposed strip by strip while they are written.
+        // Either way the staged values do not outlive the call, so they are written immediately instead of deferred.
+        template<typename T, typename RowPointer>
+        void addTransposedValues(const std::size_t rows, const std::size_t cols, RowPointer&& row_pointer) {
+            using Value = typename std::remove_const<T>::type;
+            const bool is_quantized = quantizationBits > 0 && std::is_floating_point<T>::value;
+            const bool is_narrowed = integerNarrowing && (isBinaryDataItem || isHDFDataItem) && storedPrecision == 0 && buffer != ""
+                && std::is_integral<T>::value && !std::is_same<Value, bool>::value;
+
+            if (is_quantized || is_narrowed) {
+                std::vector<Value> values(rows * cols);
+                for(std::size_t r = 0; r < rows; ++r) {
+                    const T* const row = row_pointer(r);
+                    for(std::size_t c = 0; c < cols; ++c) values[c * rows + r] = row[c];
+                }
+                addValues(values.data(), values.size(), false);
+                return;
+            }
+
+            for(std::size_t r = 0; r < rows; ++r) checkStoredValues(row_pointer(r), cols);
+            storedRangeChecked = true;
+
+            beginValues<T>(rows * cols);
+            writeTransposedValues<T>(rows, cols, row_pointer);
+            endValues();
+        }
+
+        // Deferred values
+        // Text values are split at line boundaries, so that each task formats the same text as writeValues().
+        template<typename T>
+        static void formatValues(std::string& out, const T* values_ptr, const std::size_t begin, const std::size_t end,
+                                 const std::size_t size, const std::size_t per_line, const std::string& line_break) {
+            for(std::size_t n = begin; n < end; ++n) {
+                const std::size_t i = n + 1;
+                appendValue(out, values_ptr[n]);
+
+                if (i < size) {
+                    out += ' ';
+                    if (i % per_line == 0) out += line_break;
+                }
+            }
+        }
+
+        template<typename T>
+        bool canDeferValues(const std::size_t size) const {
+            if (!deferredPool || dryRun || statisticsEnabled || isHDFDataItem || size == 0) return false;
+            if (!isBinaryDataItem) return true;
+
+            // converted values and the asynchronous engine are written in order by the calling thread
+            if (asyncHeavyData || getStoredSize<T>() != sizeof(T) || swapBytes) return false;
+#ifdef SIMPLE_XDMF_POSIX
+            return true;
+#else
+            return heavyDataMapping != nullptr;
+#endif
+        }
+
+        template<typename T>
+        void deferValues(const T* values_ptr, const std::size_t size) {
+            valuesWritten = size;
+
+            if (isBinaryDataItem) {
+                HeavyDataBlock block;
+                block.offset = heavyDataCursor;
+                block.size = size;
+                block.valueSize = sizeof(T);
+
+                const std::uint64_t bytes = static_cast<std::uint64_t>(size) * sizeof(T);
+                if (heavyDataMapping != nullptr && block.offset + bytes > heavyDataCapacity) {
+                    std::string error_message = "[SIMPLE XDMF ERROR] Values exceed the capacity of the mapped heavy data file " + heavyDataFileName + ".";
+                    throw std::length_error(error_message);
+                }
+
+                heavyDataCursor += bytes;
+                if (heavyDataStream.is_open()) {
+                    heavyDataStream.seekp(static_cast<std::streamoff>(heavyDataCursor));
+                }
+
+                deferredPool->submit([this, block, values_ptr]() { writeHeavyData(block, values_ptr); });
+                return;
+            }
+
+            // the indent of the first line is placed before the segment
+            commitInnerBuffer();
+
+            std::string line_break = newLine;
+            for(unsigned int i = 0; i < currentIndentation; ++i) line_break += indent;
+
+            const std::size_t per_line = std::max(1u, innerElementPerLine);
+            const std::size_t per_task = std::max<std::size_t>(1, deferredValuesPerTask / per_line) * per_line;
+
+            deferredSegments.emplace_back();
+            DeferredSegment& segment = deferredSegments.back();
+            segment.position = content.size();
+            segment.pieces.resize((size + per_task - 1) / per_task);
+
+            for(std::size_t k = 0; k < segment.pieces.size(); ++k) {
+                std::string* piece = &segment.pieces[k];
+                const std::size_t begin = k * per_task;
+                const std::size_t end = std::min(size, begin + per_task);
+                deferredPool->submit([piece, values_ptr, begin, end, size, per_line, line_break]() {
+                    formatValues(*piece, values_ptr, begin, end, size, per_line, line_break);
+                });
+            }
+        }
+
+        // Quantization
+        // Floating point values are stored as 8 or 16 bit unsigned integers, wrapped by
+        // a Function DataItem "$0 * scale + offset" which restores the physical values.
+        // returns the number of non-finite values, which are skipped
+        template<typename T>
+        std::size_t findFiniteMinMax(const T* values_ptr, const std::size_t size, T& min_value, T& max_value) {
+            const T max_finite = std::numeric_limits<T>::max();
+            T min_v = max_finite;
+            T max_v = -max_finite;
+            std::size_t non_finite = 0;
+
+            // branch-free so that compiler can vectorize it
+            for(std::size_t i = 0; i < size; ++i) {
+                const T v = values_ptr[i];
+                const bool is_finite = (v <= max_finite) && (v >= -max_finite);
+                min_v = (is_finite && v < min_v) ? v : min_v;
+                max_v = (is_finite && v > max_v) ? v : max_v;
+                non_finite += is_finite ? 0 : 1;
+            }
+
+            if (min_v > max_v) {
+                min_v = 0;
+                max_v = 0;
+            }
+
+            min_value = min_v;
+            max_value = max_v;
+            return non_finite;
+        }
+
+        void wrapQuantizedDataItem(const double min_value, const double max_value) {
+            const double levels = (quantizationBits == 8) ? 255.0 : 65535.0;
+            quantizationOffset = min_value;
+            quantizationScale = (max_value > min_value) ? (max_value - min_value) / levels : 0.0;
+
+            std::stringstream function;
+            function << std::setprecision(std::numeric_limits<double>::max_digits10);
+            function << "$0 * " << quantizationScale;
+            if (quantizationOffset < 0.0) {
+                function << " - " << -quantizationOffset;
+            } else {
+                function << " + " << quantizationOffset;
+            }
+
+            // insert the Function DataItem before the pending DataItem
+            std::string pending = buffer;
+            buffer.clear();
+            insertIndent();
+            buffer += "<DataItem ItemType=\"Function\"";
+            appendAttribute("Dimensions", currentDimensions);
+            appendAttribute("Function", function.str());
+            commitBuffer();
+
+            proceedCurrentXpath();
+#ifdef USE_HDF5
+            pushElementPath(TAG::DataItem);
+#endif
+            addIndent();
+            buffer = indent + pending;
+
+            // the Name belongs to the wrapped DataItem
+            if (dataItemNameEntry != noEntry) moveXpathEntry(dataItemNameEntry, currentXpathNode);
+
+            if (!isBinaryDataItem && !isHDFDataItem) {
+                buffer += (quantizationBits == 8) ? " NumberType=\"UChar\" Precision=\"1\"" : " NumberType=\"UInt\" Precision=\"2\"";
+            }
+
+            isQuantizedDataItem = true;
+        }
+
+        template<typename Q, typename T>
+        void writeQuantizedValues(const T* values_ptr, const std::size_t size) {
+            constexpr std::size_t chunkSize = 4096;
+            Q chunk[chunkSize];
+
+            const double levels = static_cast<double>(std::numeric_limits<Q>::max());
+            const double inverseScale = (quantizationScale > 0.0) ? 1.0 / quantizationScale : 0.0;
+
+            beginValues<Q>(size);
+            for(std::size_t begin = 0; begin < size; begin += chunkSize) {
+                const std::size_t count = std::min(chunkSize, size - begin);
+                const T* src = values_ptr + begin;
+                if (statisticsEnabled) accumulateStatistics(src, count);
+
+                for(std::size_t n = 0; n < count; ++n) {
+                    double q = (static_cast<double>(src[n]) - quantizationOffset) * inverseScale + 0.5;
+                    q = (q > 0.0) ? q : 0.0;
+                    q = (q < levels) ? q : levels;
+                    chunk[n] = static_cast<Q>(q);
+                }
+
+                writeValues(chunk, count);
+            }
+            endValues();
+        }
+
+        template<typename T>
+        void addQuantizedValues(const T* values_ptr, const std::size_t size, const bool values_kept = true) {
+            // following add*() calls in the same DataItem reuse scale and offset
+            if (!isQuantizedDataItem) {
+                if (current_tag != TAG::DataItem || buffer == "") {
+                    std::cerr << "[SIMPLE XDMF ERROR] quantized values must be the first values of a DataItem. Quantization is skipped." << std::endl;
+                    quantizationBits = 0;
+                    addValues(values_ptr, size, values_kept);
+                    return;
+                }
+            }
+
+            // no code restores NaN or Inf, so nothing is written
+            T min_value, max_value;
+            const std::size_t non_finite = findFiniteMinMax(values_ptr, size, min_value, max_value);
+            if (non_finite > 0) {
+                std::string error_message = "[SIMPLE XDMF ERROR] " + std::to_string(non_finite) + " non-finite values cannot be quantized.";
+                throw std::domain_error(error_message);
+            }
+
+            if (!isQuantizedDataItem) {
+                if (currentDimensions == "") {
+                    std::string error_message = "[SIMPLE XDMF ERROR] setDimensions() must be called before adding quantized values.";
+                    throw std::runtime_error(error_message);
+                }
+
+                wrapQuantizedDataItem(static_cast<double>(min_value), static_cast<double>(max_value));
+            }
+
+            if (quantizationBits == 8) {
+                writeQuantizedValues<std::uint8_t>(values_ptr, size);
+            } else {
+                writeQuantizedValues<std::uint16_t>(values_ptr, size);
+            }
+        }
+
+        // Temporal index, see setTemporalIndex()
+        std::uint64_t getOutputOffset() const {
+            return indexBaseOffset + flushedBytes + content.size();
+        }
+
+        std::string getIndexCollectionPath() const {
+            std::vector<TAG> tags;
+            for(std::uint32_t node = currentXpathNode; node != 0; node = xpathNodes[node].parent) {
+                tags.push_back(xpathNodes[node].tag);
+            }
+
+            std::string path;
+            for(auto it = tags.rbegin(); it != tags.rend(); ++it) {
+                if (!path.empty()) path += '/';
+                path += getTagString(*it);
+            }
+            return path;
+        }
+
+        static std::string formatIndexNumber(const std::uint64_t value) {
+            std::string digits = std::to_string(value);
+            return std::string(20 - digits.size(), '0') + digits;
+        }
+
+        void writeTemporalIndex(const std::string& file_name) {
+            const std::string index_file_name = file_name + ".idx";
+            if (temporalIndexPathOffset + indexCollectionPath.size() > temporalIndexHeaderSize - 1) {
+                std::string error_message = "[SIMPLE XDMF ERROR] The path " + indexCollectionPath + " of the Temporal collection is longer than " + std::to_string(temporalIndexHeaderSize - 1 - temporalIndexPathOffset) + " characters of the temporal index header.";
+                throw std::length_error(error_message);
+            }
+
+            const bool is_continued = (indexStepBase > 0 || continuedFileName != "");
+
+            std::fstream ofs(index_file_name, is_continued ? (std::ios::in | std::ios::out | std::ios::binary) : (std::ios::out | std::ios::binary | std::ios::trunc));
+            if (!ofs.is_open()) {
+                std::string error_message = "[SIMPLE XDMF ERROR] Failed to open " + index_file_name + ".";
+                throw std::runtime_error(error_message);
+            }
+
+            std::string header = "SXDMFIDX 1 " + formatIndexNumber(indexTail) + " " + formatIndexNumber(indexStepBase + indexSteps.size()) + " " + indexCollectionPath;
+            header.resize(temporalIndexHeaderSize - 1, ' ');
+            header += '\n';
+            ofs.write(header.data(), static_cast<std::streamsize>(header.size()));
+
+            // only the steps of this document are written
+            std::string records;
+            records.reserve(indexSteps.size() * temporalIndexRecordSize);
+            for(const auto& step : indexSteps) {
+                std::string time = step.time;
+                time.resize(temporalIndexTimeWidth, ' ');
+                records += formatIndexNumber(step.offset);
+                records += ' ';
+                records += time;
+                records += '\n';
+            }
+
+            ofs.seekp(static_cast<std::streamoff>(temporalIndexHeaderSize + indexStepBase * temporalIndexRecordSize));
+            ofs.write(records.data(), static_cast<std::streamsize>(records.size()));
+        }
+
+        // write a continued document over the tail of the existing file
+        void writeContinuedDocument(const std::string& file_name) {
+            std::fstream ofs(file_name, std::ios::in | std::ios::out | std::ios::binary);
+            if (!ofs.is_open()) {
+                std::string error_message = "[SIMPLE XDMF ERROR] Failed to open " + file_name + ".";
+                throw std::runtime_error(error_message);
+            }
+
+            ofs.seekp(static_cast<std::streamoff>(indexBaseOffset));
+            ofs.write(content.data(), static_cast<std::streamsize>(content.size()));
+            ofs.close();
+
+#ifdef SIMPLE_XDMF_POSIX
+            if (::truncate(file_name.c_str(), static_cast<off_t>(indexBaseOffset + content.size())) != 0) {
+                std::cerr << "[SIMPLE XDMF ERROR] Failed to truncate " << file_name << "." << std::endl;
+            }
+#endif
+        }
+
+    public:
+        SimpleXdmf() {
+            setNewLineCodeLF();
+            setIndentSpaceSize();
+            beginXdmf();
+        }
+
+        void setIndentSpaceSize(const int size = 4) {
+            if (size == 0) {
+                indent = '\t';
+                return;
+            }
+
+            indent.clear();
+            for (int i = 0; i < size; ++i) {
+                indent += ' ';
+            }
+        }
+
+        void setNewLineCodeLF() {
+            constexpr char LF = '\n';
+            newLine = LF;
+        }
+
+        void setNewLineCodeCR() {
+            constexpr char CR = '\r';
+            newLine = CR;
+        }
+
+        void setNewLineCodeCRLF() {
+            constexpr const char* CRLF = "\r\n";
+            newLine = CRLF;
+        }
+
+        ~SimpleXdmf() {
+            // deferred tasks may still write heavy data
+            deferredPool.reset();
+
+            // an unfinished durable output leaves the destination untouched, and no temporary file
+            if (durableFile != nullptr) {
+                std::fclose(durableFile);
+                std::remove(durableTemporaryFileName.c_str());
+            }
+
+            closeHeavyData();
+#ifdef USE_HDF5
+            closeHDFFile();
+#endif
+        }
+
+        // IO functions
+        void generate(const std::string file_name) {
+            if (dryRun) {
+                std::cerr << "[SIMPLE XDMF ERROR] generate() cannot be called in a dry run. Call endDryRun() first." << std::endl;
+                return;
+            }
+
+            // checked before the document is finished, so generate() can be called again with the durable target
+            if (durableFileName != "" && file_name != durableFileName) {
+                std::string error_message = "[SIMPLE XDMF ERROR] generate() is called with " + file_name + ", but durable output is written into " + durableFileName + ".";
+                throw std::invalid_argument(error_message);
+            }
+
+            if(!endEdit) endXdmf();
+
+            // already streamed and renamed by endXdmf()
+            if (durableFileName != "") {
+                if (temporalIndexEnabled && hasIndexedCollection) writeTemporalIndex(durableFileName);
+                return;
+            }
+
+            if (continuedFileName != "") {
+                writeContinuedDocument(file_name);
+                if (temporalIndexEnabled) writeTemporalIndex(file_name);
+                finishHeavyData(false);
+                return;
+            }
+
+            const std::string output_path = (stagingDirectory != "") ? getStagedPath(file_name) : file_name;
+            {
+                std::ofstream ofs(output_path, std::ios::out);
+                ofs << content;
+            }
+            const bool has_index = temporalIndexEnabled && hasIndexedCollection;
+            if (has_index) writeTemporalIndex(output_path);
+
+            finishHeavyData(false);
+
+            if (stagingDirectory != "") drainStagedFiles(output_path, file_name, has_index);
+        }
+
+#ifdef USE_HDF5
+        // DataItems with Format="HDF" store their values into datasets of this file.
+        // The file is closed by generate(), so it can be read while the program continues.
+        void setHDFFile(const std::string& file_name) {
+            closeHDFFile();
+            hdfFileName = file_name;
+            hdfFileCreated = false;
+            hdfDatasetCounts.clear();
+        }
+
+        // Split datasets into chunks of chunk_size values, 0 for contiguous datasets
+        void setHDFChunkSize(const std::size_t chunk_size) {
+            hdfChunkSize = chunk_size;
+        }
+
+        // Compress chunked datasets by deflate (0 - 9), with the shuffle filter in front of it
+        void setHDFCompression(const int deflate_level, const bool shuffle = true) {
+            if (deflate_level < 0 || deflate_level > 9) {
+                std::string error_message = "[SIMPLE XDMF ERROR] Invalid deflate level = " + std::to_string(deflate_level) + " is passed to setHDFCompression().";
+                throw std::invalid_argument(error_message);
+            }
+            hdfDeflateLevel = deflate_level;
+            hdfShuffle = shuffle;
+        }
+
+        // Datasets up to size bytes are stored in their object header instead of a separate data block.
+        // It makes files of many small DataItems smaller, while writing them is slightly slower.
+        void setHDFCompactLimit(const std::size_t size) {
+            hdfCompactLimit = std::min<std::size_t>(size, 60000);
+        }
+#endif
+
+        // Stream the document into "file_name.tmp" while it is built, and rename it to file_name by endXdmf().
+        // Buffered content is written whenever it exceeds flush_interval bytes at an element boundary,
+        // and with use_fsync = true, the files are synchronized to the storage before renaming.
+        // getRawString() returns the part of the document which is not flushed yet.
+        void setDurableOutput(const std::string& file_name, const std::size_t flush_interval = 1 << 20, const bool use_fsync = false) {
+            if (durableFile != nullptr) {
+                std::cerr << "[SIMPLE XDMF ERROR] setDurableOutput() is called twice." << std::endl;
+                return;
+            }
+
+            if (dryRun) {
+                std::cerr << "[SIMPLE XDMF ERROR] setDurableOutput() cannot be called in a dry run." << std::endl;
+                return;
+            }
+
+            durableFileName = file_name;
+            durableTemporaryFileName = file_name + ".tmp";
+            durableFlushInterval = flush_interval;
+            durableSync = use_fsync;
+
+            durableFile = std::fopen(durableTemporaryFileName.c_str(), "wb");
+            if (durableFile == nullptr) {
+                std::string error_message = "[SIMPLE XDMF ERROR] Failed to open " + durableTemporaryFileName + ".";
+                throw std::runtime_error(error_message);
+            }
+
+            flushContentIfNeeded();
+        }
+
+        // DataItems with Format="Binary" store their values into this file.
+        // NumberType, Precision and Seek attributes are set automatically.
+        // With append = true, values are appended to the existing file, which is never truncated.
+        // Threads writing heavy data blocks must be joined before this function and generate() are called.
+        void setHeavyDataFile(const std::string& file_name, const bool append = false) {
+            commitDeferredValues();
+            closeHeavyData();
+
+            heavyDataFileName = file_name;
+            heavyDataPath = (stagingDirectory != "" && file_name != "") ? getStagedPath(file_name) : file_name;
+            heavyDataOffset = 0;
+            heavyDataCursor = 0;
+
+            if (append && heavyDataPath != file_name) {
+                std::cerr << "[SIMPLE XDMF ERROR] Heavy data cannot be appended to " << file_name << " in staging mode." << std::endl;
+            } else if (append) {
+                std::ifstream existing(file_name, std::ios::in | std::ios::binary | std::ios::ate);
+                if (existing.is_open()) {
+                    heavyDataOffset = static_cast<std::uint64_t>(existing.tellg());
+                    heavyDataCursor = heavyDataOffset;
+                    heavyDataFileCreated = true;
+                }
+            }
+        }
+
+        // Write Binary DataItems asynchronously while the following values are computed.
+        // Values are staged into buffer_count aligned buffers of buffer_size bytes, and filled buffers are written
+        // by io_uring when USE_IO_URING is defined on Linux, or by a pool of threads otherwise.
+        // With use_direct_io = true, aligned buffers bypass the page cache by O_DIRECT.
+        // generate() waits only for the outstanding writes. Supported only on POSIX systems.
+        void setAsyncHeavyData(const bool enabled = true, const std::size_t buffer_size = 1 << 22, const std::size_t buffer_count = 8, const bool use_direct_io = false) {
+#ifdef SIMPLE_XDMF_POSIX
+            if (buffer_count == 0) {
+                std::string error_message = "[SIMPLE XDMF ERROR] Invalid buffer_count = 0 is passed to setAsyncHeavyData().";
+                throw std::invalid_argument(error_message);
+            }
+
+            stopHeavyDataEngine();
+            if (enabled && heavyDataStream.is_open()) heavyDataStream.flush();
+
+            asyncHeavyData = enabled;
+            asyncBufferSize = std::max<std::size_t>((buffer_size + HeavyDataEngine::alignment - 1) / HeavyDataEngine::alignment, 1) * HeavyDataEngine::alignment;
+            asyncBufferCount = buffer_count;
+            asyncDirectIO = use_direct_io;
+#else
+            (void)buffer_size;
+            (void)buffer_count;
+            (void)use_direct_io;
+            if (enabled) {
+                std::string error_message = "[SIMPLE XDMF ERROR] setAsyncHeavyData() is supported only on POSIX systems.";
+                throw std::runtime_error(error_message);
+            }
+#endif
+        }
+
+        // "io_uring" or "threads" while asynchronous heavy data output is active, "" otherwise
+        std::string getAsyncHeavyDataEngine() const {
+#ifdef SIMPLE_XDMF_POSIX
+            if (heavyDataEngine) return heavyDataEngine->getName();
+#endif
+            return "";
+        }
+
+        // Preallocate the heavy data file and map it into memory.
+        // The file is extended to max(capacity, bytes reserved so far), and values added afterwards,
+        // as well as the values of blocks returned by reserveValues(), are written straight into the mapping.
+        // The mapping is synchronized and unmapped by generate(), and the unused capacity is truncated.
+        void mapHeavyData(const std::uint64_t capacity = 0) {
+#ifdef SIMPLE_XDMF_POSIX
+            // deferred values are written before the way of writing heavy data changes
+            commitDeferredValues();
+
+            if (heavyDataMapping != nullptr) {
+                std::cerr << "[SIMPLE XDMF ERROR] mapHeavyData() is called twice." << std::endl;
+                return;
+            }
+
+            if (dryRun) {
+                std::cerr << "[SIMPLE XDMF ERROR] mapHeavyData() cannot be called in a dry run." << std::endl;
+                return;
+            }
+
+            if (heavyDataFileName == "") {
+                std::string error_message = "[SIMPLE XDMF ERROR] setHeavyDataFile() must be called before mapHeavyData().";
+                throw std::runtime_error(error_message);
+            }
+
+            // values added before are written through the mapping afterwards
+            if (heavyDataStream.is_open()) heavyDataStream.close();
+            stopHeavyDataEngine();
+
+            heavyDataCapacity = std::max(capacity, heavyDataOffset.load());
+            if (heavyDataCapacity == 0) {
+                std::string error_message = "[SIMPLE XDMF ERROR] mapHeavyData() is called without any reserved values or capacity.";
+                throw std::invalid_argument(error_message);
+            }
+
+            const int fd = openHeavyDataDescriptor();
+            bool allocated = ::ftruncate(fd, static_cast<off_t>(heavyDataCapacity)) == 0;
+#ifdef __linux__
+            // allocate the blocks now, so writing into the mapping does not fail with SIGBUS on a full disk
+            allocated = allocated && ::posix_fallocate(fd, 0, static_cast<off_t>(heavyDataCapacity)) == 0;
+#endif
+            void* mapping = allocated ? ::mmap(nullptr, static_cast<std::size_t>(heavyDataCapacity), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+            if (mapping == MAP_FAILED) {
+                heavyDataCapacity = 0;
+                std::string error_message = "[SIMPLE XDMF ERROR] Failed to map " + heavyDataFileName + ".";
+                throw std::runtime_error(error_message);
+            }
+
+            heavyDataMapping = static_cast<char*>(mapping);
+#else
+            (void)capacity;
+            std::string error_message = "[SIMPLE XDMF ERROR] mapHeavyData() is supported only on POSIX systems.";
+            throw std::runtime_error(error_message);
+#endif
+        }
+
+        // Typed view of a reserved block, valid after mapHeavyData() until generate()
+        // The pointer is aligned when the mapping is (always for files and shared memory, see setHeavyDataBuffer()).
+        template<typename T>
+        T* getHeavyData(const HeavyDataBlock& block) {
+            if (heavyDataMapping == nullptr) {
+                std::string error_message = "[SIMPLE XDMF ERROR] getHeavyData() is called before mapHeavyData().";
+                throw std::runtime_error(error_message);
+            }
+
+            if (block.valueSize != sizeof(T)) {
+                std::string error_message = "[SIMPLE XDMF ERROR] getHeavyData() is called with a type of " + std::to_string(sizeof(T)) + " bytes for a block of " + std::to_string(block.valueSize) + " bytes values.";
+                throw std::invalid_argument(error_message);
+            }
+
+            return reinterpret_cast<T*>(heavyDataMapping + block.offset);
+        }
+
+        std::string getRawString() const {
+            return content;
+        }
+
+        // The current document without a copy. It is complete after generate() or endXdmf().
+        const std::string& getContent() const {
+            return content;
+        }
+
+        // Move the finished document out. A new document is started by reset().
+        std::string releaseContent() {
+            if (!endEdit) endXdmf();
+
+            std::string released;
+            released.swap(content);
+            return released;
+        }
+
+        // Write the finished document into a caller buffer, and return its size in bytes
+        std::size_t generateToBuffer(char* output, const std::size_t capacity) {
+            if (!endEdit) endXdmf();
+
+            if (content.size() > capacity) {
+                std::string error_message = "[SIMPLE XDMF ERROR] The document of " + std::to_string(content.size()) + " bytes exceeds the buffer of " + std::to_string(capacity) + " bytes.";
+                throw std::length_error(error_message);
+            }
+
+            std::memcpy(output, content.data(), content.size());
+            finishHeavyData(false);
+            return content.size();
+        }
+
+        // Write the document and the heavy data file of generate() into a fast local directory (tmpfs or local SSD),
+        // from which drain_threads background threads copy them to their destinations, the heavy data first.
+        // The heavy data file is staged again after generate(), so the next document replaces its destination
+        // unless setHeavyDataFile() names another one. The paths written in the document are the destinations.
+        // An empty directory disables staging.
+        // The directory must exist, and this function must be called before setHeavyDataFile().
+        void setStagingDirectory(const std::string& directory, const unsigned int drain_threads = 2) {
+            if (stagingDrainer) stagingDrainer->wait();
+            stagingDrainer.reset();
+            stagingDirectory = directory;
+
+            if (directory != "") {
+                stagingDrainer.reset(new StagingDrainer(std::max(1u, drain_threads)));
+            }
+        }
+
+        DrainStatus getDrainStatus() const {
+            return stagingDrainer ? stagingDrainer->getStatus() : DrainStatus();
+        }
+
+        // Wait until all staged files are copied. Throws when any of them failed.
+        void waitForDrain() {
+            if (!stagingDrainer) return;
+
+            stagingDrainer->wait();
+            const DrainStatus status = stagingDrainer->getStatus();
+            if (status.failedFiles > 0) {
+                throw std::runtime_error(status.lastError);
+            }
+        }
+
+        // Values of Binary DataItems are written into a caller buffer of capacity bytes instead of a file.
+        // name is written as the file name of the DataItems, and Seek is the offset in the buffer.
+        // getHeavyData<T>() pointers are aligned only if output is aligned to the largest reserved type.
+        void setHeavyDataBuffer(char* output, const std::uint64_t capacity, const std::string& name = "memory") {
+            setHeavyDataFile(name);
+            heavyDataMapping = output;
+            heavyDataCapacity = capacity;
+            heavyDataSink = HeavyDataSink::Buffer;
+        }
+
+        // bytes of heavy data written so far
+        std::uint64_t getHeavyDataSize() const {
+            return heavyDataOffset.load();
+        }
+
+        // Write the snapshot into the POSIX shared memory object name (e.g. "/snapshot"), which holds
+        // a SharedMemoryHeader, the heavy data of up to heavy_data_capacity bytes, and the document
+        // written by generateSharedMemory(). A consumer on the same node maps the object with shm_open() and mmap().
+        // An existing object of the same name is unlinked and a new one is created, so a consumer which still maps
+        // the previous snapshot keeps reading it.
+        void setSharedMemoryOutput(const std::string& name, const std::uint64_t heavy_data_capacity) {
+#ifdef SIMPLE_XDMF_POSIX
+            setHeavyDataFile(name);
+
+            ::shm_unlink(name.c_str());
+            const int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+            const std::size_t size = sharedMemoryHeaderSize + static_cast<std::size_t>(heavy_data_capacity);
+            void* mapping = (fd >= 0 && ::ftruncate(fd, static_cast<off_t>(size)) == 0)
+                ? ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+            if (mapping == MAP_FAILED) {
+                if (fd >= 0) ::close(fd);
+                std::string error_message = "[SIMPLE XDMF ERROR] Failed to create the shared memory " + name + ".";
+                throw std::runtime_error(error_message);
+            }
+
+            sharedMemoryName = name;
+            sharedMemoryDescriptor = fd;
+            sharedMemoryBase = static_cast<char*>(mapping);
+            sharedMemorySize = size;
+
+            heavyDataMapping = sharedMemoryBase + sharedMemoryHeaderSize;
+            heavyDataCapacity = heavy_data_capacity;
+            heavyDataSink = HeavyDataSink::SharedMemory;
+#else
+            (void)name;
+            (void)heavy_data_capacity;
+            std::string error_message = "[SIMPLE XDMF ERROR] setSharedMemoryOutput() is supported only on POSIX systems.";
+            throw std::runtime_error(error_message);
+#endif
+        }
+
+        // Append the finished document to the shared memory object, and publish the header.
+        // The object only grows (when the document does not fit into the capacity), so mappings of the consumer stay valid.
+        // Growing remaps the object in this process, so pointers returned by getHeavyData() are invalid after this call.
+        // It is released by this SimpleXdmf, and the consumer removes it with shm_unlink().
+        void generateSharedMemory() {
+#ifdef SIMPLE_XDMF_POSIX
+            if (heavyDataSink != HeavyDataSink::SharedMemory) {
+                std::cerr << "[SIMPLE XDMF ERROR] generateSharedMemory() is called without setSharedMemoryOutput()." << std::endl;
+                return;
+            }
+
+            if (!endEdit) endXdmf();
+            finishHeavyData(false);
+
+            SharedMemoryHeader header;
+            header.headerSize = sharedMemoryHeaderSize;
+            header.heavyDataOffset = sharedMemoryHeaderSize;
+            header.heavyDataSize = heavyDataOffset.load();
+            header.xmlOffset = (header.heavyDataOffset + header.heavyDataSize + 7) / 8 * 8;
+            header.xmlSize = content.size();
+
+            const std::size_t size = static_cast<std::size_t>(header.xmlOffset + header.xmlSize);
+            if (size > sharedMemorySize) {
+                // the heavy data mapping lies inside the object, and is moved with it
+                ::munmap(sharedMemoryBase, sharedMemorySize);
+                sharedMemoryBase = nullptr;
+                heavyDataMapping = nullptr;
+
+                void* mapping = (::ftruncate(sharedMemoryDescriptor, static_cast<off_t>(size)) == 0)
+                    ? ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, sharedMemoryDescriptor, 0) : MAP_FAILED;
+                if (mapping == MAP_FAILED) {
+                    std::string error_message = "[SIMPLE XDMF ERROR] Failed to resize the shared memory " + sharedMemoryName + ".";
+                    closeHeavyData();
+                    throw std::runtime_error(error_message);
+                }
+                sharedMemoryBase = static_cast<char*>(mapping);
+                sharedMemorySize = size;
+                heavyDataMapping = sharedMemoryBase + sharedMemoryHeaderSize;
+            }
+
+            std::memcpy(sharedMemoryBase + header.xmlOffset, content.data(), content.size());
+
+            // the magic is published last, so a consumer never sees a partial snapshot
+            std::memset(header.magic, 0, sizeof(header.magic));
+            std::memcpy(sharedMemoryBase, &header, sizeof(header));
+            std::atomic_thread_fence(std::memory_order_release);
+            std::memcpy(sharedMemoryBase, "SXDMF01", 8);
+
+            closeHeavyData();
+            heavyDataFileName.clear();
+            heavyDataPath.clear();
+#else
+            std::string error_message = "[SIMPLE XDMF ERROR] generateSharedMemory() is supported only on POSIX systems.";
+            throw std::runtime_error(error_message);
+#endif
+        }
+
+        // Start a new document. Memory allocated for the previous document is kept for reuse.
+        void reset() {
+            if (durableFile != nullptr) {
+                std::cerr << "[SIMPLE XDMF ERROR] reset() cannot be called before durable output is finished." << std::endl;
+                return;
+            }
+
+            commitDeferredValues();
+
+            content.clear();
+            buffer.clear();
+            currentXpathNode = 0;
+            gridKinds.clear();
+            hasIndexedCollection = false;
+            indexTimePending = false;
+            indexSteps.clear();
+            indexStepBase = 0;
+            indexTail = 0;
+            particleSteps.clear();
+            particleStepBase = 0;
+            indexBaseOffset = 0;
+            continuedFileName.clear();
+            nameRegistry.clear();
+            nameEntries.clear();
+            nameCounts.clear();
+            currentIndentation = -1;
+            resetStatistics();
+            lastStatistics = DataStatistics();
+            currentAttributeName.clear();
+#ifdef USE_HDF5
+            elementPath.clear();
+            elementPathLengths.clear();
+            hdfDatasetCounts.clear();
+#endif
+            beginXdmf();
+        }
+
+        // Preallocate memory for a document of the given size in bytes
+        void reserve(const std::size_t size) {
+            content.reserve(size);
+            buffer.reserve(std::min<std::size_t>(size, 1 << 16));
+        }
+
+        // Values added by add*() functions are formatted (XML) or written (Binary) by a work stealing pool
+        // of thread_count threads (0: hardware concurrency), and the text is committed into the document in
+        // program order when the enclosing Grid or Domain ends. Values are not copied, so they must be kept
+        // alive and unchanged until then, or until commitDeferredValues() is called. Values with statistics,
+        // conversion, quantization, HDF and asynchronous output are written immediately, and so are the values
+        // of add2DArray(), add3DArray() and addMultiArray(), which are transposed through a staging buffer.
+        void setDeferredValues(const bool enabled = true, unsigned int thread_count = 0) {
+            commitDeferredValues();
+            deferredPool.reset();
+
+            if (enabled) {
+                if (thread_count == 0) thread_count = std::max(1u, std::thread::hardware_concurrency());
+                deferredPool.reset(new DeferredTaskPool(thread_count));
+            }
+        }
+
+        // Wait for the deferred values, and insert their text into the document
+        void commitDeferredValues() {
+            if (!deferredPool) return;
+
+            std::exception_ptr error;
+            try {
+                deferredPool->wait();
+            } catch (...) {
+                error = std::current_exception();
+            }
+
+            if (!deferredSegments.empty()) {
+                std::size_t total = content.size();
+                for(const auto& segment : deferredSegments) {
+                    for(const auto& piece : segment.pieces) total += piece.size();
+                }
+
+                std::string merged;
+                merged.reserve(std::max(total, content.capacity()));
+                std::size_t position = 0;
+                for(const auto& segment : deferredSegments) {
+                    merged.append(content, position, segment.position - position);
+                    for(const auto& piece : segment.pieces) merged += piece;
+                    position = segment.position;
+                }
+                merged.append(content, position, std::string::npos);
+
+                content.swap(merged);
+                deferredSegments.clear();
+            }
+
+            if (error) std::rethrow_exception(error);
+        }
+
+        // Dry run
+        // The begin*/set*/add*/end* calls between beginDryRun() and endDryRun() are processed as usual,
+        // except that values are not formatted or written and no file is touched. endDryRun() returns
+        // the sizes of the document and the heavy data, and starts a new document for the real pass,
+        // which makes the same calls after applyOutputPlan().
+        void beginDryRun() {
+            if (durableFile != nullptr) {
+                std::cerr << "[SIMPLE XDMF ERROR] beginDryRun() cannot be called with durable output." << std::endl;
+                return;
+            }
+
+            // datasets of the earlier documents stay in the HDF file, so both passes continue their names
+#ifdef USE_HDF5
+            dryRunHDFDatasetCounts = hdfDatasetCounts;
+#endif
+            reset();
+#ifdef USE_HDF5
+            hdfDatasetCounts = dryRunHDFDatasetCounts;
+#endif
+            dryRun = true;
+            dryRunPlan = OutputPlan();
+            dryRunHeavyDataStart = heavyDataOffset;
+        }
+
+        OutputPlan endDryRun() {
+            if (!dryRun) {
+                std::cerr << "[SIMPLE XDMF ERROR] endDryRun() is called without beginDryRun()." << std::endl;
+                return OutputPlan();
+            }
+
+            if (!endEdit) endXdmf();
+
+            OutputPlan plan = dryRunPlan;
+            plan.documentBytes += content.size();
+            plan.heavyDataBytes = heavyDataOffset - dryRunHeavyDataStart;
+
+            dryRun = false;
+            heavyDataOffset = dryRunHeavyDataStart;
+            heavyDataCursor = dryRunHeavyDataStart;
+            reset();
+#ifdef USE_HDF5
+            hdfDatasetCounts = dryRunHDFDatasetCounts;
+#endif
+
+            return plan;
+        }
+
+        bool isDryRun() const {
+            return dryRun;
+        }
+
+        // Reserve the memory of the document and preallocate the heavy data file at once.
+        // The unused tail of the preallocated file is truncated by generate().
+        void applyOutputPlan(const OutputPlan& plan) {
+            reserve(plan.documentBytes);
 
-            std::ofstream ofs(file_name, std::ios::out);
-            ofs << content;
-        }
+            if (plan.heavyDataBytes == 0 || heavyDataFileName == "" || heavyDataMapping != nullptr) return;
 
-        std::string getRawString() const {
-            return content;
+#ifdef SIMPLE_XDMF_POSIX
+            const int fd = openHeavyDataDescriptor();
+            const off_t size = static_cast<off_t>(heavyDataOffset.load() + plan.heavyDataBytes);
+#ifdef __linux__
+            const bool allocated = ::posix_fallocate(fd, 0, size) == 0;
+#else
+            const bool allocated = ::ftruncate(fd, size) == 0;
+#endif
+            if (!allocated) {
+                std::string error_message = "[SIMPLE XDMF ERROR] Failed to preallocate " + heavyDataFileName + ".";
+                throw std::runtime_error(error_message);
+            }
+            heavyDataPreallocated = true;
+#endif
         }
 
         void beginXdmf() {
             endEdit = false;
+            if (durableFile == nullptr) {
+                durableFileName.clear();
+                flushedBytes = 0;
+            }
             content = header;
-            beginElement("Xdmf");
+            beginElement(TAG::Xdmf);
         }
 
         void endXdmf() {
-            endElement("Xdmf");
+            commitDeferredValues();
+            endElement(TAG::Xdmf);
             endEdit = true;
+
+            if (durableFile != nullptr) {
+                finishDurableOutput();
+            }
         }
 
         void beginDomain(const std::string& name = "") {
-            beginElement("Domain");
+            beginElement(TAG::Domain);
             setName(name);
         };
 
         void endDomain() {
-            endElement("Domain");
+            commitDeferredValues();
+            endElement(TAG::Domain);
         };
 
         void beginGrid(const std::string& name = "", const std::string& type = "Uniform") {
-            beginElement("Grid");
+            unsigned char kind = OtherGrid;
+            if (!gridKinds.empty() && gridKinds.back() == IndexedCollection) {
+                kind = IndexedStep;
+
+                // the step starts at its own line
+                commitDeferredValues();
+                if (buffer != "") commitBuffer();
+                TemporalStep step;
+                step.offset = getOutputOffset();
+                indexSteps.push_back(step);
+            }
+            gridKinds.push_back(kind);
+
+            beginElement(TAG::Grid);
             addType(type);
             setName(name);
         }
 
         void endGrid() {
-            endElement("Grid");
+            commitDeferredValues();
+
+            if (!gridKinds.empty()) {
+                if (gridKinds.back() == IndexedCollection) {
+                    if (buffer != "") commitBuffer();
+                    indexTail = getOutputOffset();
+                }
+                gridKinds.pop_back();
+            }
+
+            endElement(TAG::Grid);
         }
 
         void beginUnstructuredTopology(const std::string& name = "", const std::string& type = "Polyvertex") {
-            beginElement("UnstructuredTopology");
+            beginElement(TAG::UnstructuredTopology);
             addType(type);
             setName(name);
         }
 
         void endUnstructuredTopology() {
-            endElement("UnstructuredTopology");
+            endElement(TAG::UnstructuredTopology);
         }
 
         void beginStructuredTopology(const std::string& name = "", const std::string& type = "2DCoRectMesh") {
-            beginElement("StructuredTopology");
+            beginElement(TAG::StructuredTopology);
             addType(type);
             setName(name);
         }
 
         void endStructuredTopology() {
-            endOneLineElement("StructuredTopology");
+            endOneLineElement();
         }
 
         void beginGeometory(const std::string& name = "", const std::string& type = "XYZ"){
-            beginElement("Geometry");
+            beginElement(TAG::Geometry);
             addType(type);
             setName(name);
         }
 
         void endGeometory(){
-            endElement("Geometry");
+            endElement(TAG::Geometry);
         }
 
         void beginAttribute(const std::string& name = "", const std::string& type = "Scalar"){
-            beginElement("Attribute");
+            beginElement(TAG::Attribute);
             addType(type);
             setName(name);
+            currentAttributeName = name;
         }
 
         void endAttribute(){
-            endElement("Attribute");
+            endElement(TAG::Attribute);
+            currentAttributeName.clear();
         }
 
         void beginDataItem(const std::string& name = "", const std::string& type = "Uniform") {
-            beginElement("DataItem");
+            isBinaryDataItem = false;
+            isHDFDataItem = false;
+            quantizationBits = 0;
+            isQuantizedDataItem = false;
+            storedPrecision = 0;
+            storedUnsigned = false;
+            dataItemEndian.clear();
+            swapBytes = false;
+            storedRangeChecked = false;
+            currentDimensions.clear();
+            dataItemNameEntry = noEntry;
+            resetStatistics();
+
+            beginElement(TAG::DataItem);
             addType(type);
             setName(name);
+            if (dryRun) ++dryRunPlan.dataItemCount;
+
+            statistics.name = currentAttributeName;
+            if (statisticsEnabled) appendXpathNode(statistics.xpath, currentXpathNode);
         }
 
         void endDataItem() {
-            endElement("DataItem");
+            endElement(TAG::DataItem);
+
+            // close the wrapping Function DataItem
+            if (isQuantizedDataItem) {
+                endElement(TAG::DataItem);
+                isQuantizedDataItem = false;
+            }
+
+            if (hasStatistics) {
+                commitStatistics();
+            }
         }
 
         void beginSet(const std::string& name = "", const std::string& type = "Node") {
-            beginElement("Set");
+            beginElement(TAG::Set);
             addType(type);
             setName(name);
         }
 
         void endSet() {
-            endElement("Set");
+            endElement(TAG::Set);
         }
 
         void beginTime(const std::string& name = "", const std::string& type = "Single") {
-            beginElement("Time");
+            beginElement(TAG::Time);
             addType(type);
             setName(name);
+
+            indexTimePending = !gridKinds.empty() && gridKinds.back() == IndexedStep;
         }
 
         void endTime() {
-            endElement("Time");
+            indexTimePending = false;
+            endElement(TAG::Time);
         }
 
         void beginInformation(const std::string& name = "") {
-            beginElement("Information");
+            beginElement(TAG::Information);
             setName(name);
         }
 
         void endInformation() {
-            endElement("Information");
+            endElement(TAG::Information);
         }
 
         template<typename T>
-        void addArray(const T* values_ptr, const int N) {
-            beginInnerElement();
+        void addArray(const T* values_ptr, const std::size_t N) {
+            addValues(values_ptr, N);
+        }
 
-            std::stringstream ss;
-            for(size_t i = 1; i <= N; ++i) {
-                ss << values_ptr[i - 1];
+        template<typename T>
+        void add2DArray(T** values_ptr, const std::size_t nx, const std::size_t ny) {
+            // values_ptr[i] is contiguous along y, while XDMF order runs along x first
+            addTransposedValues<T>(nx, ny, [values_ptr](const std::size_t i) { return values_ptr[i]; });
+        }
 
-                if (i < N) {
-                    ss << " ";
+        template<typename T>
+        void add3DArray(T*** values_ptr, const std::size_t nx, const std::size_t ny, const std::size_t nz) {
+            // values_ptr[i][j] is contiguous along z, while XDMF order runs along x first
+            addTransposedValues<T>(nx * ny, nz, [values_ptr, nx](const std::size_t r) { return values_ptr[r % nx][r / nx]; });
+        }
 
-                    if (i % innerElementPerLine == 0) {
-                        buffer += ss.str() + newLine;
-                        insertIndent();
-                        ss.str("");
-                        ss.clear(std::stringstream::goodbit);
-                    }
+        // Allocate a range of size values in the heavy data file.
+        // This function and writeHeavyData() can be called from any thread,
+        // and the values of each block are written concurrently by positional writes.
+        // mapHeavyData(), setHeavyDataBuffer() and generate() must not run concurrently with them.
+        // Blocks are referred from Binary DataItems by addHeavyDataBlock().
+        // The offset is rounded up to alignof(T), so that getHeavyData<T>() returns an aligned pointer.
+        template<typename T>
+        HeavyDataBlock allocateHeavyData(const std::size_t size) {
+            HeavyDataBlock block;
+            block.size = size;
+            block.valueSize = sizeof(T);
+
+            const std::uint64_t bytes = static_cast<std::uint64_t>(size) * sizeof(T);
+            const std::uint64_t alignment = alignof(T);
+            std::uint64_t offset = heavyDataOffset.load();
+            do {
+                block.offset = (offset + alignment - 1) / alignment * alignment;
+
+                // checked before the range is taken, so a failed allocation leaves no hole
+                if (heavyDataMapping != nullptr && block.offset + bytes > heavyDataCapacity) {
+                    std::string error_message = "[SIMPLE XDMF ERROR] Allocated values exceed the capacity of the mapped heavy data file " + heavyDataFileName + ".";
+                    throw std::length_error(error_message);
                 }
-            }
-
-            if (ss.str() != "") {
-                buffer += ss.str() + newLine;
-            }
+            } while (!heavyDataOffset.compare_exchange_weak(offset, block.offset + bytes));
 
-            endInnerElement();
+            return block;
         }
 
+        // Write the values of a block allocated by allocateHeavyData(). Thread safe.
         template<typename T>
-        void add2DArray(T** values_ptr, const int nx, const int ny) {
-            beginInnerElement();
-
-            std::stringstream ss;
-
-            size_t itr = 1;
-            size_t size = nx * ny;
+        void writeHeavyData(const HeavyDataBlock& block, const T* values_ptr) {
+            if (block.valueSize != sizeof(T)) {
+                std::string error_message = "[SIMPLE XDMF ERROR] writeHeavyData() is called with a type of " + std::to_string(sizeof(T)) + " bytes for a block of " + std::to_string(block.valueSize) + " bytes values.";
+                throw std::invalid_argument(error_message);
+            }
 
-            for(size_t j = 1; j <= ny; ++j) {
-                for(size_t i = 1; i <= nx; ++i) {
-                    ss << values_ptr[i - 1][j - 1];
+            const char* data = reinterpret_cast<const char*>(values_ptr);
+            std::size_t bytes = block.size * sizeof(T);
 
-                    if (itr < size) {
-                        ss << " ";
+            if (dryRun) return;
 
-                        if (itr % innerElementPerLine == 0) {
-                            buffer += ss.str() + newLine;
-                            insertIndent();
-                            ss.str("");
-                            ss.clear(std::stringstream::goodbit);
-                        }
-                    }
+            if (heavyDataMapping != nullptr) {
+                std::memcpy(heavyDataMapping + block.offset, data, bytes);
+                return;
+            }
 
-                    ++itr;
+#ifdef SIMPLE_XDMF_POSIX
+            const int fd = openHeavyDataDescriptor();
+            off_t offset = static_cast<off_t>(block.offset);
+            while (bytes > 0) {
+                const ssize_t written = ::pwrite(fd, data, bytes, offset);
+                if (written < 0) {
+                    if (errno == EINTR) continue;
+                    std::string error_message = "[SIMPLE XDMF ERROR] Failed to write into " + heavyDataFileName + ".";
+                    throw std::runtime_error(error_message);
                 }
-            }
 
-            if (ss.str() != "") {
-                buffer += ss.str() + newLine;
+                data += written;
+                bytes -= static_cast<std::size_t>(written);
+                offset += written;
             }
-
-            endInnerElement();
+#else
+            openHeavyDataDescriptor();
+#endif
         }
 
-        template<typename T, size_t N>
-        void addArray(const std::array<T, N>& values) {
-            beginInnerElement();
-
-            std::stringstream ss;
-            for(size_t i = 1; i <= N; ++i) {
-                ss << values[i - 1];
-
-                if (i < N) {
-                    ss << " ";
+        // Refer a block allocated by allocateHeavyData() from the current Binary DataItem.
+        // The values of the block are stored as they are (setStoredPrecision(), setEndian() and setQuantization() are not applied).
+        template<typename T>
+        void addHeavyDataBlock(const HeavyDataBlock& block) {
+            if (!isBinaryDataItem || buffer == "") {
+                std::cerr << "[SIMPLE XDMF ERROR] addHeavyDataBlock() can be called only once in a Binary DataItem." << std::endl;
+                return;
+            }
 
-                    if (i % innerElementPerLine == 0) {
-                        buffer += ss.str() + newLine;
-                        insertIndent();
-                        ss.str("");
-                        ss.clear(std::stringstream::goodbit);
-                    }
-                }
+            if (block.valueSize != sizeof(T)) {
+                std::string error_message = "[SIMPLE XDMF ERROR] addHeavyDataBlock() is called with a type of " + std::to_string(sizeof(T)) + " bytes for a block of " + std::to_string(block.valueSize) + " bytes values.";
+                throw std::invalid_argument(error_message);
             }
 
-            if (ss.str() != "") {
-                buffer += ss.str() + newLine;
+            const std::string& endian = (dataItemEndian != "") ? dataItemEndian : heavyDataEndian;
+            const bool swap = (endian == "Big" && isLittleEndianHost()) || (endian == "Little" && !isLittleEndianHost());
+            if (getStoredSize<T>() != sizeof(T) || swap || quantizationBits != 0) {
+                std::string error_message = "[SIMPLE XDMF ERROR] Values of heavy data blocks cannot be converted while they are stored.";
+                throw std::invalid_argument(error_message);
             }
 
-            endInnerElement();
+            appendBinaryAttributes<T>(block.offset);
         }
 
+        // Reserve size values in the heavy data file for the current Binary DataItem without writing them.
+        // The values are filled later through getHeavyData() after mapHeavyData(), or by writeHeavyData().
         template<typename T>
-        void addVector(const std::vector<T>& values) {
-            beginInnerElement();
+        HeavyDataBlock reserveValues(const std::size_t size) {
+            if (!isBinaryDataItem) {
+                std::cerr << "[SIMPLE XDMF ERROR] reserveValues() can be called only in a Binary DataItem." << std::endl;
+                return HeavyDataBlock();
+            }
 
-            std::stringstream ss;
-            auto size = values.size();
-            for(size_t i = 1; i <= size; ++i) {
-                ss << values[i - 1];
+            const HeavyDataBlock block = allocateHeavyData<T>(size);
+            addHeavyDataBlock<T>(block);
+            return block;
+        }
 
-                if (i < size) {
-                    ss << " ";
+        // Values are generated chunk by chunk by generator(T* chunk, std::size_t offset, std::size_t count),
+        // which fills chunk with the values [offset, offset + count) of the DataItem.
+        // Huge DataItems can be written without holding all values in memory.
+        // Quantization and integer narrowing need all values at once, so they are rejected before anything is written.
+        // When integers are stored in a type which may not hold them (setStoredPrecision()), all chunks are generated
+        // and checked first, so the generator is called twice for each chunk and must return the same values.
+        template<typename T, typename Generator>
+        void addGeneratedValues(const std::size_t size, Generator&& generator) {
+            if (quantizationBits > 0 && std::is_floating_point<T>::value) {
+                std::string error_message = "[SIMPLE XDMF ERROR] addGeneratedValues() cannot quantize values. Use addVector() or addArray() instead.";
+                throw std::invalid_argument(error_message);
+            }
+            if (integerNarrowing && (isBinaryDataItem || isHDFDataItem) && storedPrecision == 0 && buffer != ""
+                && std::is_integral<T>::value && !std::is_same<T, bool>::value) {
+                std::string error_message = "[SIMPLE XDMF ERROR] addGeneratedValues() cannot narrow integer values. Call setStoredPrecision() to choose the stored type.";
+                throw std::invalid_argument(error_message);
+            }
 
-                    if (i % innerElementPerLine == 0) {
-                        buffer += ss.str() + newLine;
-                        insertIndent();
-                        ss.str("");
-                        ss.clear(std::stringstream::goodbit);
-                    }
+            constexpr std::size_t chunkSize = 1 << 16;
+            std::vector<T> chunk(std::min(chunkSize, size));
+
+            if (isBinaryDataItem && std::is_integral<T>::value
+                && (getStoredSize<T>() != sizeof(T) || isStoredSigned<T>() != std::is_signed<T>::value)) {
+                for(std::size_t begin = 0; begin < size; begin += chunkSize) {
+                    const std::size_t count = std::min(chunkSize, size - begin);
+                    generator(chunk.data(), begin, count);
+                    checkStoredValues(chunk.data(), count);
                 }
             }
+            storedRangeChecked = true;
 
-            if (ss.str() != "") {
-                buffer += ss.str() + newLine;
+            beginValues<T>(size);
+            for(std::size_t begin = 0; begin < size; begin += chunkSize) {
+                const std::size_t count = std::min(chunkSize, size - begin);
+                generator(chunk.data(), begin, count);
+                writeValues(chunk.data(), count);
             }
+            endValues();
+        }
 
-            endInnerElement();
+        template<typename T, size_t N>
+        void addArray(const std::array<T, N>& values) {
+            addValues(values.data(), N);
+        }
+
+        template<typename T>
+        void addVector(const std::vector<T>& values) {
+            addValues(values.data(), values.size());
         }
 
 #ifdef USE_BOOST
         // based on c_index_order (row-major)
         template<typename T, size_t N>
         void addMultiArray(const boost::multi_array<T, N>& values, const bool isFortranStorageOrder = false) {
-            const int size = values.num_elements();
+            const std::size_t size = values.num_elements();
 
             if (isFortranStorageOrder) {
                 addArray(values.data(), size);
             } else {
-                using array_type = boost::multi_array<T, N>;
-                boost::array<typename array_type::index, N> index;
-
-                // initialize index
-                for(int i = 0; i < N; ++i) {
-                    index[i] = 0;
-                }
-                auto shape = values.shape();
-
-                // capture index and shape
-                std::function<void(int)> proceedIndex = [&index, &shape, &proceedIndex](const int axis){
-                    if (axis < N) {
-                        // increments from the most left index
-                        index[axis] += 1;
-                        if (index[axis] == shape[axis]) {
-                            index[axis] = 0;
-                            proceedIndex(axis + 1);
-                        }
-                    }
-                };
-
-                beginInnerElement();
-                std::stringstream ss;
-                for (size_t i = 1; i <= size; ++i) {
-                    ss << values(index);
-                    proceedIndex(0);
-
-                    if (i < size) {
-                        ss << " ";
-
-                        if (i % innerElementPerLine == 0) {
-                            buffer += ss.str() + newLine;
-                            insertIndent();
-                            ss.str("");
-                            ss.clear(std::stringstream::goodbit);
-                        }
-                    }
+                // XDMF order runs along the first index first, which is the reversed order of c_storage_order.
+                // Each plane of the last (contiguous) index is a transposition of the remaining indices.
+                const auto shape = values.shape();
+                const auto strides = values.strides();
+                const T* origin = values.origin();
+
+                std::size_t rows = 1;
+                for(size_t axis = 0; axis + 1 < N; ++axis) {
+                    rows *= shape[axis];
                 }
 
-                if (ss.str() != "") {
-                    buffer += ss.str() + newLine;
-                }
+                // r enumerates the remaining indices in XDMF order (the first index runs first)
+                auto row_pointer = [&shape, &strides, origin](std::size_t r) {
+                    const T* row = origin;
+                    for(size_t axis = 0; axis + 1 < N; ++axis) {
+                        row += static_cast<std::ptrdiff_t>(r % shape[axis]) * strides[axis];
+                        r /= shape[axis];
+                    }
+                    return row;
+                };
 
-                endInnerElement();
+                addTransposedValues<T>(rows, shape[N - 1], row_pointer);
             }
         }
 #endif
@@ -687,9 +4300,8 @@ class SimpleXdmf {
         void addItem(Args&&... args) {
             beginInnerElement();
 
-            std::stringstream ss;
-            addItemInternal(ss, std::forward<Args>(args)...);
-            buffer += ss.str() + newLine;
+            appendArgs(buffer, std::forward<Args>(args)...);
+            buffer += newLine;
 
             endInnerElement();
         }
@@ -697,8 +4309,12 @@ class SimpleXdmf {
         // --- Attirbute Setting Functions ---
         void setName(const std::string& name) {
             if (name != "") {
-                addNewXpath(name, currentXpath);
-                buffer += " Name=\"" + name + "\"";
+                const std::uint32_t entry = addNewXpath(name, currentXpathNode);
+                if (current_tag == TAG::DataItem) dataItemNameEntry = entry;
+                appendAttribute("Name", name);
+#ifdef USE_HDF5
+                setElementPathName(name);
+#endif
             }
         }
 
@@ -707,12 +4323,18 @@ class SimpleXdmf {
                 std::cerr << "[SIMPLE XDMF ERROR] setVersion() cannot be called when current Tag is not Xdmf." << std::endl;
                 return;
             }
-            buffer += " Version=\"" + _version + "\"";
+            appendAttribute("Version", _version);
         }
 
         void setFormat(const std::string& type = "XML") {
             if (checkIsValidType<formatTypeLength>(FormatType, type)) {
-                buffer += " Format=\"" + type + "\"";
+                if (current_tag == TAG::DataItem) {
+                    isBinaryDataItem = (type == "Binary");
+#ifdef USE_HDF5
+                    isHDFDataItem = (type == "HDF");
+#endif
+                }
+                appendAttribute("Format", type);
             } else {
                 std::string error_message = "[SIMPLE XDMF ERROR] Invalid Format type = " + type + " is passed to setFormat().";
                 throw std::invalid_argument(error_message);
@@ -721,7 +4343,7 @@ class SimpleXdmf {
 
         void setPrecision(const std::string& type = "4") {
             if (checkIsValidType<precisionTypeLength>(PrecisionType, type)) {
-                buffer += " Precision=\"" + type + "\"";
+                appendAttribute("Precision", type);
             } else {
                 std::string error_message = "[SIMPLE XDMF ERROR] Invalid Precision type = " + type + " is passed to setPrecision().";
                 throw std::invalid_argument(error_message);
@@ -730,7 +4352,7 @@ class SimpleXdmf {
 
         void setNumberType(const std::string& type = "Float") {
             if (checkIsValidType<numberTypeLength>(NumberType, type)) {
-                buffer += " NumberType=\"" + type + "\"";
+                appendAttribute("NumberType", type);
             } else {
                 std::string error_message = "[SIMPLE XDMF ERROR] Invalid Number type = " + type + " is passed to setNumberType().";
                 throw std::invalid_argument(error_message);
@@ -744,7 +4366,7 @@ class SimpleXdmf {
             }
 
             if (checkIsValidType<attributeCenterLength>(AttributeCenter, type)) {
-                buffer += " Center=\"" + type + "\"";
+                appendAttribute("Center", type);
             } else {
                 std::string error_message = "[SIMPLE XDMF ERROR] Invalid Center type = " + type + " is passed to setCenter().";
                 throw std::invalid_argument(error_message);
@@ -756,7 +4378,7 @@ class SimpleXdmf {
                 std::cerr << "[SIMPLE XDMF ERROR] setFunction() cannot be called when current Tag is not DataItem." << std::endl;
                 return;
             }
-            buffer += " Function=\"" + func + "\"";
+            appendAttribute("Function", func);
         }
 
         void setSection(const std::string& sect) {
@@ -766,7 +4388,7 @@ class SimpleXdmf {
             }
 
             if (sect == "DataItem" || sect == "All") {
-                buffer += " Section=\"" + sect + "\"";
+                appendAttribute("Section", sect);
             } else {
                 std::string error_message = "[SIMPLE XDMF ERROR] Invalid Section type = " + sect + " is passed to setSection().";
                 throw std::invalid_argument(error_message);
@@ -778,7 +4400,18 @@ class SimpleXdmf {
                 std::cerr << "[SIMPLE XDMF ERROR] setValue() cannot be called when current Tag is not Time and Information." << std::endl;
                 return;
             }
-            buffer += " Value=\"" + value + "\"";
+
+            // records of the temporal index have a fixed width
+            if (indexTimePending && current_tag == TAG::Time && value.size() > temporalIndexTimeWidth) {
+                std::string error_message = "[SIMPLE XDMF ERROR] Time value " + value + " is longer than " + std::to_string(temporalIndexTimeWidth) + " characters of the temporal index.";
+                throw std::length_error(error_message);
+            }
+            appendAttribute("Value", value);
+
+            if (indexTimePending && current_tag == TAG::Time) {
+                indexSteps.back().time = value;
+                indexTimePending = false;
+            }
         }
 
         void setCollectionType(const std::string& type) {
@@ -788,7 +4421,13 @@ class SimpleXdmf {
             }
 
             if (type == "Temporal") {
-                buffer += " CollectionType=\"" + type + "\"";
+                appendAttribute("CollectionType", type);
+
+                if (!hasIndexedCollection && !gridKinds.empty()) {
+                    hasIndexedCollection = true;
+                    gridKinds.back() = IndexedCollection;
+                    indexCollectionPath = getIndexCollectionPath();
+                }
             } else {
                 std::string error_message = "[SIMPLE XDMF ERROR] Invalid Collection type = " + type + " is passed to setCollectionType().";
                 throw std::invalid_argument(error_message);
@@ -798,33 +4437,125 @@ class SimpleXdmf {
 
         template<typename... Args>
         void setDimensions(Args&&... args) {
-            std::string dimString = convertFromVariadicArgsToString(std::forward<Args>(args)...);
-            buffer += " Dimensions=\"" + dimString + "\"";
+            buffer += " Dimensions=\"";
+            const auto dimensions_begin = buffer.size();
+            appendReversedArgs(buffer, std::forward<Args>(args)...);
+
+            if (current_tag == TAG::DataItem) {
+                currentDimensions.assign(buffer, dimensions_begin, buffer.size() - dimensions_begin);
+            }
+            buffer += '"';
+        }
+
+        // Store values of the current Binary DataItem with the given Precision, e.g. double as float
+        // with "4", or int64_t as int32_t with "4" (throws std::overflow_error if values do not fit).
+        void setStoredPrecision(const std::string& type) {
+            if (current_tag != TAG::DataItem) {
+                std::cerr << "[SIMPLE XDMF ERROR] setStoredPrecision() cannot be called when current Tag is not DataItem." << std::endl;
+                return;
+            }
+
+            if (checkIsValidType<precisionTypeLength>(PrecisionType, type)) {
+                storedPrecision = static_cast<std::size_t>(std::stoi(type));
+            } else {
+                std::string error_message = "[SIMPLE XDMF ERROR] Invalid Precision type = " + type + " is passed to setStoredPrecision().";
+                throw std::invalid_argument(error_message);
+            }
+        }
+
+        // Store integer values of Binary DataItems with the narrowest NumberType and Precision
+        // which can represent them, e.g. connectivity of std::vector<int64_t> as UInt with Precision 4.
+        // Applies to addVector() and addArray() unless setStoredPrecision() is called.
+        void setIntegerNarrowing(const bool enabled = true) {
+            integerNarrowing = enabled;
+        }
+
+        // Byte order of the current Binary DataItem: "Native", "Big" or "Little".
+        // Values are swapped while they are written if the byte order differs from the host.
+        void setEndian(const std::string& endian) {
+            if (current_tag != TAG::DataItem) {
+                std::cerr << "[SIMPLE XDMF ERROR] setEndian() cannot be called when current Tag is not DataItem." << std::endl;
+                return;
+            }
+
+            if (checkIsValidEndian(endian, "setEndian()")) {
+                dataItemEndian = endian;
+            }
+        }
+
+        // Byte order of all Binary DataItems without setEndian()
+        void setHeavyDataEndian(const std::string& endian) {
+            if (checkIsValidEndian(endian, "setHeavyDataEndian()")) {
+                heavyDataEndian = endian;
+            }
+        }
+
+        // Compute min, max, mean and NaN/Inf counts of the values added into each DataItem
+        // while they are written. Results are inserted as Information elements after the DataItem.
+        void setStatistics(const bool enabled = true) {
+            statisticsEnabled = enabled;
+        }
+
+        void setStatisticsCallback(const std::function<void(const DataStatistics&)>& callback) {
+            statisticsCallback = callback;
+        }
+
+        const DataStatistics& getLastStatistics() const {
+            return lastStatistics;
+        }
+
+        // Store floating point values of the current DataItem as bits = 8 or 16 unsigned integers.
+        // The DataItem is wrapped by a Function DataItem which restores the original range.
+        void setQuantization(const int bits = 16) {
+            if (current_tag != TAG::DataItem) {
+                std::cerr << "[SIMPLE XDMF ERROR] setQuantization() cannot be called when current Tag is not DataItem." << std::endl;
+                return;
+            }
+
+            if (bits == 8 || bits == 16) {
+                quantizationBits = bits;
+            } else {
+                std::string error_message = "[SIMPLE XDMF ERROR] Invalid quantization bits = " + std::to_string(bits) + " is passed to setQuantization().";
+                throw std::invalid_argument(error_message);
+            }
         }
 
         template<typename... Args>
         void setNumberOfElements(Args&&... args) {
-            std::string dimString = convertFromVariadicArgsToString(std::forward<Args>(args)...);
-            buffer += " NumberOfElements=\"" + dimString + "\"";
+            buffer += " NumberOfElements=\"";
+            appendReversedArgs(buffer, std::forward<Args>(args)...);
+            buffer += '"';
         }
 
         // Reference Attribute management
         void setReference(const std::string& xpath) {
-            buffer += " Reference=\"" + xpath + "\"";
+            appendAttribute("Reference", xpath);
         }
 
-        void setReferenceFromName(const std::string& name) {
-            auto xpath = getXpath(name);
-            buffer += " Reference=\"" + xpath + "\"";
+        // occurrence selects one of elements with the duplicated Name (see setPositionalXpath())
+        void setReferenceFromName(const std::string& name, const std::size_t occurrence = 0) {
+            buffer += " Reference=\"";
+            appendXpath(buffer, name, occurrence);
+            buffer += '"';
+        }
+
+        void addReferenceFromName(const std::string& name, const std::size_t occurrence = 0) {
+            beginInnerElement();
+
+            appendXpath(buffer, name, occurrence);
+            buffer += newLine;
+
+            endInnerElement();
         }
 
-        void addReferenceFromName(const std::string& name) {
-            auto xpath = getXpath(name);
-            addItem(xpath);
+        // Register all elements with duplicated Names to refer them by positional xpaths.
+        // By default, only the first element with a Name can be referred.
+        void setPositionalXpath(const bool enabled = true) {
+            positionalXpath = enabled;
         }
 
         // helper functoins
-        void begin2DStructuredGrid(const std::string& gridName, const std::string& topologyType, const int nx, const int ny) {
+        void begin2DStructuredGrid(const std::string& gridName, const std::string& topologyType, const std::size_t nx, const std::size_t ny) {
             beginGrid(gridName);
 
             beginStructuredTopology("", topologyType);
@@ -857,7 +4588,7 @@ class SimpleXdmf {
             endGeometory();
         }
 
-        void begin3DStructuredGrid(const std::string& gridName, const std::string& topologyType, const int nx, const int ny, const int nz) {
+        void begin3DStructuredGrid(const std::string& gridName, const std::string& topologyType, const std::size_t nx, const std::size_t ny, const std::size_t nz) {
             beginGrid(gridName);
 
             beginStructuredTopology("", topologyType);
@@ -869,6 +4600,342 @@ class SimpleXdmf {
             endGrid();
         }
 
+        // Write only the active entries of an attribute as a Set of the given center,
+        // which holds the indices of the active entries and an Attribute of their values.
+        // values_ptr holds size * components values, and an entry i is active when mask[i] != 0.
+        // Indices are stored as 32 bit integers when they fit.
+        template<typename T, typename Mask>
+        void addSparseAttribute(const std::string& name, const T* values_ptr, const Mask* mask, const std::size_t size,
+                                const std::size_t components = 1, const std::string& center = "Cell", const std::string& format = "XML") {
+            if (components == 0) {
+                std::string error_message = "[SIMPLE XDMF ERROR] addSparseAttribute() is called with 0 components.";
+                throw std::invalid_argument(error_message);
+            }
+
+            addSparseAttributeValues(name, values_ptr, mask, size, components, center, format);
+        }
+
+        template<typename T, typename Mask>
+        void addSparseAttribute(const std::string& name, const std::vector<T>& values, const std::vector<Mask>& mask,
+                                const std::size_t components = 1, const std::string& center = "Cell", const std::string& format = "XML") {
+            if (components == 0 || values.size() != mask.size() * components) {
+                std::string error_message = "[SIMPLE XDMF ERROR] addSparseAttribute() is called with " + std::to_string(values.size()) + " values for a mask of " + std::to_string(mask.size()) + " entries.";
+                throw std::invalid_argument(error_message);
+            }
+
+            // std::vector<bool> has no data()
+            addSparseAttributeValues(name, values.data(), mask, mask.size(), components, center, format);
+        }
+
+        // Write an Attribute of the current Grid for each field in one blocked pass over their values, so that
+        // fields read from one array of cell structures share the cache lines of each block. Every field has size items.
+        // Values are stored with the given format ("XML" or "Binary") as they are, so Binary values are rejected when
+        // setHeavyDataEndian() or setIntegerNarrowing() would convert them. The statistics of each DataItem are inserted
+        // after it with setStatistics().
+        template<typename T>
+        void addAttributes(const std::vector<AttributeField<T>>& fields, const std::size_t size, const std::string& center = "Cell", const std::string& format = "XML") {
+            for(const auto& field : fields) {
+                if (field.components == 0 || (field.values == nullptr && size > 0) || (field.stride != 0 && field.stride < field.components * sizeof(T))) {
+                    std::string error_message = "[SIMPLE XDMF ERROR] Invalid field " + field.name + " is passed to addAttributes().";
+                    throw std::invalid_argument(error_message);
+                }
+            }
+
+            if (format != "XML" && format != "Binary") {
+                std::string error_message = "[SIMPLE XDMF ERROR] Invalid Format type = " + format + " is passed to addAttributes().";
+                throw std::invalid_argument(error_message);
+            }
+
+            if (format == "Binary") {
+                if (heavyDataFileName == "") {
+                    std::string error_message = "[SIMPLE XDMF ERROR] setHeavyDataFile() must be called before adding values to a Binary DataItem.";
+                    throw std::runtime_error(error_message);
+                }
+
+                const bool swap = (heavyDataEndian == "Big" && isLittleEndianHost()) || (heavyDataEndian == "Little" && !isLittleEndianHost());
+                const bool narrow = integerNarrowing && std::is_integral<T>::value && !std::is_same<T, bool>::value;
+                if (swap || narrow) {
+                    std::string error_message = "[SIMPLE XDMF ERROR] Values of addAttributes() cannot be converted while they are stored.";
+                    throw std::invalid_argument(error_message);
+                }
+            }
+
+            addBatchedAttributes(fields, size, center, format);
+        }
+
+        // Particle time series
+        // Each step is a Polyvertex Grid in a Temporal Collection, whose positions and attributes
+        // are appended to the heavy data file in the order of the steps.
+        // A restarted run passes the number of steps written before as first_step, so that step names continue.
+        // Steps added after continueTemporalFile() continue from the index without beginParticleSeries().
+        void beginParticleSeries(const std::string& name = "Particles", const std::size_t first_step = 0) {
+            beginGrid(name, "Collection");
+            setCollectionType("Temporal");
+            particleSteps.clear();
+            particleStepBase = first_step;
+        }
+
+        void endParticleSeries() {
+            endGrid();
+        }
+
+        // positions are count * 3 values of x, y, z, and attributes are pairs of a Name and count values
+        template<typename T>
+        void addParticleStep(const double time, const T* positions, const std::size_t count, const std::vector<std::pair<std::string, const T*>>& attributes = {}) {
+            if (heavyDataFileName == "") {
+                std::string error_message = "[SIMPLE XDMF ERROR] setHeavyDataFile() must be called before addParticleStep().";
+                throw std::runtime_error(error_message);
+            }
+
+            ParticleStep step;
+            step.time = time;
+            step.count = count;
+
+            std::string time_value;
+            appendValue(time_value, time);
+
+            beginGrid("Step" + std::to_string(particleStepBase + particleSteps.size()));
+                beginTime();
+                    setValue(time_value);
+                endTime();
+
+                beginUnstructuredTopology("", "Polyvertex");
+                    setNumberOfElements(count);
+                endUnstructuredTopology();
+
+                beginGeometory("", "XYZ");
+                    step.begin = addParticleDataItem(positions, count, 3);
+                endGeometory();
+
+                for(const auto& attribute : attributes) {
+                    beginAttribute(attribute.first);
+                        setCenter("Node");
+                        addParticleDataItem(attribute.second, count, 1);
+                    endAttribute();
+                }
+            endGrid();
+
+            step.end = heavyDataCursor;
+            particleSteps.push_back(step);
+        }
+
+        template<typename T>
+        void addParticleStep(const double time, const std::vector<T>& positions, const std::vector<std::pair<std::string, const T*>>& attributes = {}) {
+            addParticleStep(time, positions.data(), positions.size() / 3, attributes);
+        }
+
+        // steps added since beginParticleSeries()
+        const std::vector<ParticleStep>& getParticleSteps() const {
+            return particleSteps;
+        }
+
+        // Temporal index
+        // generate() writes "<file>.idx" next to the document, which records the byte offset and Time value
+        // of each child Grid of the first Temporal collection and the offset of its closing tag.
+        void setTemporalIndex(const bool enabled = true) {
+            temporalIndexEnabled = enabled;
+        }
+
+        // Start a document which continues the Temporal collection of file_name from its index, without reading the document.
+        // Following beginGrid() calls add steps to the collection, and the enclosing elements are closed by endGrid(),
+        // endDomain() and so on as usual. generate(file_name) overwrites the closing tags with the new steps and updates the index.
+        // Names of the existing document cannot be referred.
+        void continueTemporalFile(const std::string& file_name) {
+            if (durableFile != nullptr || stagingDirectory != "") {
+                std::cerr << "[SIMPLE XDMF ERROR] continueTemporalFile() cannot be used with durable or staged output." << std::endl;
+                return;
+            }
+
+            std::ifstream ifs(file_name + ".idx", std::ios::in | std::ios::binary);
+            std::string header(temporalIndexHeaderSize, '\0');
+            ifs.read(&header[0], static_cast<std::streamsize>(header.size()));
+            if (!ifs || header.compare(0, 11, "SXDMFIDX 1 ") != 0) {
+                std::string error_message = "[SIMPLE XDMF ERROR] " + file_name + ".idx is not a temporal index.";
+                throw std::runtime_error(error_message);
+            }
+
+            reset();
+            temporalIndexEnabled = true;
+            hasIndexedCollection = true;
+            indexTail = std::stoull(header.substr(11, 20));
+            indexStepBase = static_cast<std::size_t>(std::stoull(header.substr(32, 20)));
+            particleStepBase = indexStepBase;
+            indexCollectionPath = header.substr(temporalIndexPathOffset);
+            indexCollectionPath.erase(indexCollectionPath.find_last_not_of(" \n") + 1);
+            indexBaseOffset = indexTail;
+            continuedFileName = file_name;
+
+            // enter the enclosing elements without writing them
+            content.clear();
+            buffer.clear();
+            std::stringstream path(indexCollectionPath);
+            std::string tag_name;
+            std::getline(path, tag_name, '/'); // Xdmf
+            while (std::getline(path, tag_name, '/')) {
+                if (tag_name != "Domain" && tag_name != "Grid") {
+                    std::string error_message = "[SIMPLE XDMF ERROR] Unsupported element " + tag_name + " in the index of " + file_name + ".";
+                    throw std::runtime_error(error_message);
+                }
+
+                current_tag = (tag_name == "Domain") ? TAG::Domain : TAG::Grid;
+                addIndent();
+                proceedCurrentXpath();
+#ifdef USE_HDF5
+                pushElementPath(current_tag);
+#endif
+                if (current_tag == TAG::Grid) gridKinds.push_back(OtherGrid);
+            }
+            gridKinds.back() = IndexedCollection;
+        }
+
+        // Number of steps in the index of file_name
+        static std::size_t getTemporalStepCount(const std::string& file_name) {
+            std::ifstream ifs(file_name + ".idx", std::ios::in | std::ios::binary);
+            std::string header(temporalIndexHeaderSize, '\0');
+            ifs.read(&header[0], static_cast<std::streamsize>(header.size()));
+            if (!ifs || header.compare(0, 11, "SXDMFIDX 1 ") != 0) {
+                std::string error_message = "[SIMPLE XDMF ERROR] " + file_name + ".idx is not a temporal index.";
+                throw std::runtime_error(error_message);
+            }
+            return static_cast<std::size_t>(std::stoull(header.substr(32, 20)));
+        }
+
+        // Read the step-th step of the index of file_name by one seek.
+        // The Grid of the step starts at offset in the document.
+        static TemporalStep readTemporalStep(const std::string& file_name, const std::size_t step) {
+            std::ifstream ifs(file_name + ".idx", std::ios::in | std::ios::binary);
+            ifs.seekg(static_cast<std::streamoff>(temporalIndexHeaderSize + step * temporalIndexRecordSize));
+
+            std::string record(temporalIndexRecordSize, '\0');
+            ifs.read(&record[0], static_cast<std::streamsize>(record.size()));
+            if (!ifs) {
+                std::string error_message = "[SIMPLE XDMF ERROR] Step " + std::to_string(step) + " is not found in " + file_name + ".idx.";
+                throw std::out_of_range(error_message);
+            }
+
+            TemporalStep result;
+            result.offset = std::stoull(record.substr(0, 20));
+            result.time = record.substr(21, temporalIndexTimeWidth);
+            result.time.erase(result.time.find_last_not_of(' ') + 1);
+            return result;
+        }
+
+        // Write an AMR hierarchy in one call, as a Tree Grid of one Collection Grid per level,
+        // whose blocks are 3DCoRectMesh Grids named "Block<index in blocks>" carrying the fields as Attributes.
+        // The values of each field are packed into one range of the heavy data file, and the blocks are
+        // rendered and written by thread_count threads (0: hardware concurrency). Supported only on POSIX systems.
+        // The fields bypass the DataItem path: they are always Binary values stored as T in native byte order,
+        // so setHeavyDataEndian() and setStatistics() are rejected, and HDF output and integer narrowing do not apply.
+        template<typename T>
+        void addAMRHierarchy(const std::string& name, const std::vector<AMRBlock>& blocks, const std::vector<AMRField<T>>& fields = {}, unsigned int thread_count = 0) {
+            for(const auto& field : fields) {
+                if (field.values.size() != blocks.size()) {
+                    std::string error_message = "[SIMPLE XDMF ERROR] Field " + field.name + " of addAMRHierarchy() does not have the values of all blocks.";
+                    throw std::invalid_argument(error_message);
+                }
+                if (field.center != "Cell" && field.center != "Node") {
+                    std::string error_message = "[SIMPLE XDMF ERROR] Invalid Center type = " + field.center + " is passed to addAMRHierarchy().";
+                    throw std::invalid_argument(error_message);
+                }
+                for(const T* values : field.values) {
+                    if (values == nullptr) {
+                        std::string error_message = "[SIMPLE XDMF ERROR] Field " + field.name + " of addAMRHierarchy() has no values for a block.";
+                        throw std::invalid_argument(error_message);
+                    }
+                }
+            }
+            if (!fields.empty() && heavyDataFileName == "") {
+                std::string error_message = "[SIMPLE XDMF ERROR] setHeavyDataFile() must be called before addAMRHierarchy() with fields.";
+                throw std::runtime_error(error_message);
+            }
+            if (!fields.empty() && (heavyDataEndian != "" || statisticsEnabled)) {
+                std::string error_message = "[SIMPLE XDMF ERROR] addAMRHierarchy() with fields cannot be combined with setHeavyDataEndian() or setStatistics().";
+                throw std::runtime_error(error_message);
+            }
+
+            // blocks ordered by level
+            std::vector<std::size_t> order(blocks.size());
+            for(std::size_t i = 0; i < order.size(); ++i) order[i] = i;
+            std::stable_sort(order.begin(), order.end(), [&blocks](const std::size_t a, const std::size_t b) { return blocks[a].level < blocks[b].level; });
+
+            // one range per field, split into the blocks in the order of the document
+            std::vector<HeavyDataBlock> ranges(fields.size());
+            std::vector<std::uint64_t> seeks(fields.size() * blocks.size());
+            for(std::size_t f = 0; f < fields.size(); ++f) {
+                std::size_t total = 0;
+                for(const std::size_t i : order) {
+                    seeks[f * blocks.size() + i] = total;
+                    total += getAMRValueCount(blocks[i], fields[f].center);
+                }
+
+                ranges[f] = allocateHeavyData<T>(total);
+                for(std::size_t i = 0; i < blocks.size(); ++i) {
+                    seeks[f * blocks.size() + i] = ranges[f].offset + seeks[f * blocks.size() + i] * sizeof(T);
+                }
+            }
+
+            beginGrid(name, "Tree");
+            commitBuffer();
+
+            // blocks are placed two levels below the Tree Grid
+            const unsigned int depth = currentIndentation + 2;
+            std::vector<std::string> texts(blocks.size());
+
+            if (thread_count == 0) thread_count = std::max(1u, std::thread::hardware_concurrency());
+            runInParallel(blocks.size(), thread_count, [&](const std::size_t begin, const std::size_t end) {
+                for(std::size_t i = begin; i < end; ++i) {
+                    renderAMRBlock(texts[i], depth, i, blocks[i], fields, seeks);
+
+                    for(std::size_t f = 0; f < fields.size(); ++f) {
+                        HeavyDataBlock part;
+                        part.offset = seeks[f * blocks.size() + i];
+                        part.size = getAMRValueCount(blocks[i], fields[f].center);
+                        part.valueSize = sizeof(T);
+                        writeHeavyData(part, fields[f].values[i]);
+                    }
+                }
+            });
+
+            // the document and the names are built in order
+            for(std::size_t begin = 0; begin < order.size();) {
+                const unsigned int level = blocks[order[begin]].level;
+                beginGrid("Level" + std::to_string(level), "Collection");
+                commitBuffer();
+
+                proceedCurrentXpath();
+                std::size_t end = begin;
+                for(; end < order.size() && blocks[order[end]].level == level; ++end) {
+                    addNewXpath("Block" + std::to_string(order[end]), currentXpathNode);
+                    content += texts[order[end]];
+                    flushContentIfNeeded();
+                }
+                regressCurrentXpath();
+
+                endGrid();
+                begin = end;
+            }
+
+            endGrid();
+        }
+
+        // Write downsampled copies of a structured grid as extra CoRectMesh Grids named "<name>_x2", "<name>_x4", ...
+        // with the same origin and scaled spacing, so that a cheap preview can be opened before the full grid.
+        // nx, ny and nz are the numbers of points, and the values of each field are in XDMF order (x runs first).
+        // Levels stop early when the grid cannot be halved any more. Values are stored with the given format ("XML", "Binary" or "HDF").
+        template<typename T>
+        void add3DPreviewLevels(const std::string& name, const std::size_t nx, const std::size_t ny, const std::size_t nz,
+                                const double origin_x, const double origin_y, const double origin_z, const double dx, const double dy, const double dz,
+                                const std::vector<PreviewField<T>>& fields, const std::string& format = "XML", const unsigned int levels = 3, unsigned int thread_count = 0) {
+            addPreviewLevels(name, {{nx, ny, nz}}, {{origin_x, origin_y, origin_z}}, {{dx, dy, dz}}, fields, format, levels, thread_count);
+        }
+
+        template<typename T>
+        void add2DPreviewLevels(const std::string& name, const std::size_t nx, const std::size_t ny,
+                                const double origin_x, const double origin_y, const double dx, const double dy,
+                                const std::vector<PreviewField<T>>& fields, const std::string& format = "XML", const unsigned int levels = 3, unsigned int thread_count = 0) {
+            addPreviewLevels(name, {{nx, ny, 1}}, {{origin_x, origin_y, 0.0}}, {{dx, dy, 0.0}}, fields, format, levels, thread_count);
+        }
+
         template<typename T>
         void add3DGeometryOrigin(const std::string& geomName, const T origin_x, const T origin_y, const T origin_z, const T dx, const T dy, const T dz) {
             beginGeometory(geomName, "ORIGIN_DXDYDZ");
@@ -1,8 +1,1438 @@
 #include <test_simple_xdmf.hpp>
+#include <thread>
+#include <regex>
+#ifdef SIMPLE_XDMF_POSIX
+#include <dirent.h>
+#endif
 
 namespace TEST_SIMPLE_XDMF {
 
     TEST_F(Test1, aaaaa) {
         ASSERT_EQ(2, 2);
     }
-}
\ No newline at end of file
+
+    TEST_F(Test1, QuantizedDataItemIsWrappedByFunction) {
+        SimpleXdmf gen;
+        gen.setPositionalXpath();
+        std::vector<double> values = {-1.0, 0.0, 1.0, 0.5};
+        std::vector<double> non_finite = {0.0, std::nan("")};
+
+        gen.beginAttribute("Attr1");
+            gen.beginDataItem("Quantized");
+                gen.setDimensions(4);
+                gen.setFormat("XML");
+                gen.setQuantization(8);
+                gen.addVector(values);
+            gen.endDataItem();
+            gen.beginDataItem();
+                gen.setReferenceFromName("Quantized");
+            gen.endDataItem();
+        gen.endAttribute();
+
+        gen.beginAttribute("Attr2");
+            gen.beginDataItem();
+                gen.setDimensions(2);
+                gen.setQuantization(8);
+                EXPECT_THROW(gen.addVector(non_finite), std::domain_error);
+            gen.endDataItem();
+            gen.beginDataItem();
+                gen.setQuantization(8);
+                EXPECT_THROW(gen.addVector(values), std::runtime_error);
+            gen.endDataItem();
+        gen.endAttribute();
+
+        const auto xml = gen.getRawString();
+        EXPECT_NE(xml.find("ItemType=\"Function\" Dimensions=\"4\" Function=\"$0 * "), std::string::npos);
+        EXPECT_NE(xml.find(" - 1\">"), std::string::npos);
+        EXPECT_NE(xml.find("NumberType=\"UChar\" Precision=\"1\""), std::string::npos);
+        EXPECT_NE(xml.find("0 128 255 191"), std::string::npos);
+        EXPECT_NE(xml.find("Reference=\"/Xdmf/Attribute/DataItem/DataItem[@Name='Quantized']\""), std::string::npos);
+
+        // nothing is written for the rejected values
+        EXPECT_EQ(xml.find("ItemType=\"Function\" Dimensions=\"2\""), std::string::npos);
+        EXPECT_EQ(xml.find("ItemType=\"Function\" Dimensions=\"\""), std::string::npos);
+    }
+
+    TEST_F(Test1, StatisticsAreInsertedAsInformation) {
+        SimpleXdmf gen;
+        gen.setStatistics();
+
+        std::vector<float> values = {1.0f, 2.0f, 6.0f, std::nanf(""), std::numeric_limits<float>::infinity()};
+
+        gen.beginAttribute("Attr1");
+            gen.beginDataItem();
+                gen.setDimensions(5);
+                gen.addVector(values);
+            gen.endDataItem();
+        gen.endAttribute();
+
+        const auto& stats = gen.getLastStatistics();
+        EXPECT_EQ(stats.name, "Attr1");
+        EXPECT_EQ(stats.count, 5u);
+        EXPECT_EQ(stats.nanCount, 1u);
+        EXPECT_EQ(stats.infCount, 1u);
+        EXPECT_DOUBLE_EQ(stats.min, 1.0);
+        EXPECT_DOUBLE_EQ(stats.max, 6.0);
+        EXPECT_DOUBLE_EQ(stats.mean, 3.0);
+
+        // a Name of the user is not shadowed by the Information elements
+        gen.beginInformation("Max");
+        gen.endInformation();
+        gen.beginGrid("Grid1");
+            gen.setReferenceFromName("Max");
+        gen.endGrid();
+
+        const auto xml = gen.getRawString();
+        EXPECT_NE(xml.find("<Information Name=\"Max\" Value=\"6\">"), std::string::npos);
+        EXPECT_NE(xml.find("<Information Name=\"NaNCount\" Value=\"1\">"), std::string::npos);
+        EXPECT_NE(xml.find("Reference=\"/Xdmf/Information[@Name='Max']\""), std::string::npos);
+    }
+
+    TEST_F(Test1, DurableOutputIsRenamedAtEnd) {
+        const std::string file_name = "durable_output_test.xmf";
+        std::remove(file_name.c_str());
+
+        std::vector<int> values(1000, 7);
+        {
+            SimpleXdmf gen;
+            gen.setDurableOutput(file_name, 64, true);
+
+            gen.beginDomain();
+                gen.beginGrid("Grid1");
+                    gen.beginAttribute("Attr1");
+                        gen.beginDataItem();
+                            gen.setDimensions(values.size());
+                            gen.addVector(values);
+                        gen.endDataItem();
+                    gen.endAttribute();
+                gen.endGrid();
+
+                // content is streamed into the temporary file
+                EXPECT_LT(gen.getRawString().size(), 64u + 32u);
+                EXPECT_FALSE(std::ifstream(file_name).good());
+                EXPECT_TRUE(std::ifstream(file_name + ".tmp").good());
+            gen.endDomain();
+
+            // the document is written only into the durable target
+            EXPECT_THROW(gen.generate("other_" + file_name), std::invalid_argument);
+            EXPECT_FALSE(std::ifstream("other_" + file_name).good());
+            gen.generate(file_name);
+        }
+
+        std::ifstream ifs(file_name);
+        std::stringstream ss;
+        ss << ifs.rdbuf();
+        const auto xml = ss.str();
+
+        EXPECT_EQ(xml.find("<?xml"), 0u);
+        EXPECT_NE(xml.find("</Xdmf>"), std::string::npos);
+        EXPECT_NE(xml.find("7 7 7"), std::string::npos);
+        EXPECT_FALSE(std::ifstream(file_name + ".tmp").good());
+        std::remove(file_name.c_str());
+
+        // an unfinished document is discarded
+        {
+            SimpleXdmf gen;
+            gen.setDurableOutput(file_name, 64);
+            gen.beginDomain();
+            EXPECT_TRUE(std::ifstream(file_name + ".tmp").good());
+        }
+        EXPECT_FALSE(std::ifstream(file_name).good());
+        EXPECT_FALSE(std::ifstream(file_name + ".tmp").good());
+    }
+
+    TEST_F(Test1, DuplicatedNamesAreReferredByPosition) {
+        SimpleXdmf gen;
+        gen.setPositionalXpath();
+
+        gen.beginDomain();
+            gen.beginGrid("Grid1", "Collection");
+                gen.beginGrid("Grid1");
+                gen.endGrid();
+            gen.endGrid();
+
+            gen.beginGrid("Grid1");
+            gen.endGrid();
+
+            gen.beginGrid("Grid2");
+            gen.setReferenceFromName("Grid1");
+            gen.endGrid();
+
+            gen.beginGrid("Grid3");
+            gen.setReferenceFromName("Grid1", 2);
+            gen.endGrid();
+
+            gen.beginGrid("Grid4");
+            gen.setReferenceFromName("Grid1", 1);
+            gen.endGrid();
+        gen.endDomain();
+
+        const auto xml = gen.getRawString();
+        EXPECT_NE(xml.find("Name=\"Grid2\" Reference=\"/Xdmf/Domain/Grid[@Name='Grid1']\""), std::string::npos);
+        EXPECT_NE(xml.find("Name=\"Grid3\" Reference=\"(/Xdmf/Domain/Grid[@Name='Grid1'])[2]\""), std::string::npos);
+        EXPECT_NE(xml.find("Name=\"Grid4\" Reference=\"/Xdmf/Domain/Grid/Grid[@Name='Grid1']\""), std::string::npos);
+    }
+
+    TEST_F(Test1, DataItemBeyond32BitSize) {
+        const std::size_t size = (std::size_t(1) << 31) + 8;
+
+        SimpleXdmf gen;
+        gen.setHeavyDataFile("/dev/null");
+
+        gen.beginDataItem();
+            gen.setDimensions(size);
+            gen.setFormat("Binary");
+            gen.addGeneratedValues<std::uint8_t>(size, [](std::uint8_t* chunk, std::size_t offset, std::size_t count) {
+                std::fill(chunk, chunk + count, static_cast<std::uint8_t>(offset));
+            });
+        gen.endDataItem();
+
+        gen.beginDataItem();
+            gen.setDimensions(1);
+            gen.setFormat("Binary");
+            std::vector<double> values = {1.0};
+            gen.addVector(values);
+        gen.endDataItem();
+
+        const auto xml = gen.getRawString();
+        EXPECT_NE(xml.find("Dimensions=\"2147483656\" Format=\"Binary\" NumberType=\"UChar\" Precision=\"1\" Seek=\"0\""), std::string::npos);
+        EXPECT_NE(xml.find("NumberType=\"Float\" Precision=\"8\" Seek=\"2147483656\""), std::string::npos);
+    }
+
+    TEST_F(Test1, BinaryValuesAreConvertedToStoredPrecisionAndEndian) {
+        const std::string heavy_data_file = "conversion_test.bin";
+
+        SimpleXdmf gen;
+        gen.setHeavyDataFile(heavy_data_file);
+
+        std::vector<double> doubles = {1.5, -2.0};
+        gen.beginDataItem();
+            gen.setDimensions(2);
+            gen.setFormat("Binary");
+            gen.setStoredPrecision("4");
+            gen.setEndian("Big");
+            gen.addVector(doubles);
+        gen.endDataItem();
+
+        // the overflow of the last chunk is found before anything is written
+        std::vector<std::int64_t> too_large(10000, 1);
+        too_large.back() = std::int64_t(1) << 40;
+        gen.beginDataItem();
+            gen.setDimensions(too_large.size());
+            gen.setFormat("Binary");
+            gen.setStoredPrecision("4");
+            EXPECT_THROW(gen.addVector(too_large), std::overflow_error);
+        gen.endDataItem();
+        gen.generate("conversion_test.xmf");
+
+        const auto xml = gen.getRawString();
+        EXPECT_NE(xml.find("NumberType=\"Float\" Precision=\"4\" Endian=\"Big\" Seek=\"0\""), std::string::npos);
+        EXPECT_EQ(xml.find("Seek=\"8\""), std::string::npos);
+        std::ifstream heavy_data(heavy_data_file, std::ios::binary | std::ios::ate);
+        EXPECT_EQ(static_cast<std::size_t>(heavy_data.tellg()), 8u);
+        heavy_data.close();
+
+        std::ifstream ifs(heavy_data_file, std::ios::binary);
+        unsigned char bytes[8];
+        ifs.read(reinterpret_cast<char*>(bytes), 8);
+        // 1.5f = 0x3FC00000, -2.0f = 0xC0000000 in big endian
+        EXPECT_EQ(bytes[0], 0x3F);
+        EXPECT_EQ(bytes[1], 0xC0);
+        EXPECT_EQ(bytes[4], 0xC0);
+        EXPECT_EQ(bytes[5], 0x00);
+
+        std::remove(heavy_data_file.c_str());
+        std::remove("conversion_test.xmf");
+    }
+
+    TEST_F(Test1, IntegersAreNarrowed) {
+        SimpleXdmf gen;
+        gen.setHeavyDataFile("/dev/null");
+        gen.setIntegerNarrowing();
+
+        std::vector<std::int64_t> connectivity = {0, 1, 70000, 3};
+        gen.beginDataItem();
+            gen.setDimensions(4);
+            gen.setFormat("Binary");
+            gen.addVector(connectivity);
+        gen.endDataItem();
+
+        std::vector<int> flags = {-1, 0, 1};
+        gen.beginDataItem();
+            gen.setDimensions(3);
+            gen.setFormat("Binary");
+            gen.addVector(flags);
+        gen.endDataItem();
+
+        std::vector<std::uint32_t> ids = {10, 200};
+        gen.beginDataItem();
+            gen.setDimensions(2);
+            gen.setFormat("Binary");
+            gen.addVector(ids);
+        gen.endDataItem();
+
+        const auto xml = gen.getRawString();
+        EXPECT_NE(xml.find("NumberType=\"UInt\" Precision=\"4\" Seek=\"0\""), std::string::npos);
+        EXPECT_NE(xml.find("NumberType=\"Char\" Precision=\"1\" Seek=\"16\""), std::string::npos);
+        EXPECT_NE(xml.find("NumberType=\"UChar\" Precision=\"1\" Seek=\"19\""), std::string::npos);
+    }
+
+    TEST_F(Test1, ReservedValuesAreWrittenThroughMapping) {
+        const std::string heavy_file = "mapped_heavy_data_test.bin";
+        addGeneratedFiles({heavy_file, "mapped_heavy_data_test.xmf"});
+        std::vector<int> added = {5, 6};
+
+        {
+            SimpleXdmf gen;
+            gen.setHeavyDataFile(heavy_file);
+
+            gen.beginDataItem();
+                gen.setDimensions(3);
+                gen.setFormat("Binary");
+                const auto block_double = gen.reserveValues<double>(3);
+            gen.endDataItem();
+
+            gen.beginDataItem();
+                gen.setDimensions(4);
+                gen.setFormat("Binary");
+                const auto block_int = gen.reserveValues<int>(4);
+            gen.endDataItem();
+
+            gen.mapHeavyData(1024);
+
+            double* d = gen.getHeavyData<double>(block_double);
+            int* n = gen.getHeavyData<int>(block_int);
+            for (int i = 0; i < 3; ++i) d[i] = 0.5 * i;
+            for (int i = 0; i < 4; ++i) n[i] = 10 + i;
+
+            gen.beginDataItem();
+                gen.setDimensions(2);
+                gen.setFormat("Binary");
+                gen.addVector(added);
+            gen.endDataItem();
+
+            const auto xml = gen.getRawString();
+            EXPECT_NE(xml.find("Precision=\"8\" Seek=\"0\""), std::string::npos);
+            EXPECT_NE(xml.find("Precision=\"4\" Seek=\"24\""), std::string::npos);
+            EXPECT_NE(xml.find("Precision=\"4\" Seek=\"40\""), std::string::npos);
+
+            gen.generate("mapped_heavy_data_test.xmf");
+        }
+
+        const std::string bytes = readFile(heavy_file);
+        ASSERT_EQ(bytes.size(), 48u);
+
+        double d[3];
+        int n[6];
+        std::memcpy(d, bytes.data(), sizeof(d));
+        std::memcpy(n, bytes.data() + 24, sizeof(n));
+        EXPECT_EQ(d[2], 1.0);
+        EXPECT_EQ(n[0], 10);
+        EXPECT_EQ(n[3], 13);
+        EXPECT_EQ(n[4], 5);
+        EXPECT_EQ(n[5], 6);
+    }
+
+    TEST_F(Test1, ReservedBlocksAreAligned) {
+        const std::string heavy_file = "aligned_heavy_data_test.bin";
+        addGeneratedFiles({heavy_file, "aligned_heavy_data_test.xmf"});
+
+        {
+            SimpleXdmf gen;
+            gen.setHeavyDataFile(heavy_file);
+
+            gen.beginDataItem();
+                gen.setDimensions(3);
+                gen.setFormat("Binary");
+                const auto block_char = gen.reserveValues<char>(3);
+            gen.endDataItem();
+
+            gen.beginDataItem();
+                gen.setDimensions(2);
+                gen.setFormat("Binary");
+                const auto block_double = gen.reserveValues<double>(2);
+            gen.endDataItem();
+
+            EXPECT_EQ(block_double.offset % alignof(double), 0u);
+            EXPECT_NE(gen.getRawString().find("Precision=\"8\" Seek=\"8\""), std::string::npos);
+
+            gen.mapHeavyData(64);
+            char* c = gen.getHeavyData<char>(block_char);
+            double* d = gen.getHeavyData<double>(block_double);
+            EXPECT_EQ(reinterpret_cast<std::uintptr_t>(d) % alignof(double), 0u);
+            c[0] = 'a'; c[1] = 'b'; c[2] = 'c';
+            d[0] = 1.5;
+            d[1] = 2.5;
+
+            // a rejected allocation does not take any range
+            EXPECT_THROW(gen.allocateHeavyData<double>(8), std::length_error);
+            EXPECT_EQ(gen.getHeavyDataSize(), 24u);
+            EXPECT_EQ(gen.allocateHeavyData<double>(5).offset, 24u);
+
+            gen.generate("aligned_heavy_data_test.xmf");
+        }
+
+        const std::string bytes = readFile(heavy_file);
+        ASSERT_EQ(bytes.size(), 64u);
+
+        double d[2];
+        std::memcpy(d, bytes.data() + 8, sizeof(d));
+        EXPECT_EQ(bytes[2], 'c');
+        EXPECT_EQ(bytes[3], 0);
+        EXPECT_EQ(d[1], 2.5);
+    }
+
+    TEST_F(Test1, HeavyDataBlocksAreWrittenConcurrently) {
+        const std::string heavy_file = "parallel_heavy_data_test.bin";
+        addGeneratedFiles({heavy_file, "parallel_heavy_data_test.xmf"});
+        constexpr int threadCount = 4;
+        constexpr std::size_t size = 1000;
+
+        SimpleXdmf gen;
+        gen.setHeavyDataFile(heavy_file);
+
+        std::vector<SimpleXdmf::HeavyDataBlock> blocks(threadCount);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < threadCount; ++t) {
+            threads.emplace_back([&gen, &blocks, t]() {
+                std::vector<int> values(size, t);
+                blocks[t] = gen.allocateHeavyData<int>(size);
+                gen.writeHeavyData(blocks[t], values.data());
+            });
+        }
+        for (auto& thread : threads) thread.join();
+
+        gen.beginDomain();
+        for (int t = 0; t < threadCount; ++t) {
+            gen.beginAttribute("Attr" + std::to_string(t));
+                gen.beginDataItem();
+                    gen.setDimensions(size);
+                    gen.setFormat("Binary");
+                    gen.addHeavyDataBlock<int>(blocks[t]);
+                gen.endDataItem();
+            gen.endAttribute();
+        }
+
+        // add*() functions continue after the allocated blocks
+        std::vector<int> added = {-1, -2};
+        gen.beginDataItem();
+            gen.setDimensions(2);
+            gen.setFormat("Binary");
+            gen.addVector(added);
+        gen.endDataItem();
+        gen.endDomain();
+        gen.generate("parallel_heavy_data_test.xmf");
+
+        const auto xml = gen.getRawString();
+        EXPECT_NE(xml.find("Seek=\"16000\""), std::string::npos);
+
+        std::ifstream ifs(heavy_file, std::ios::binary);
+        std::vector<int> stored((threadCount * size) + 2);
+        ifs.read(reinterpret_cast<char*>(stored.data()), static_cast<std::streamsize>(stored.size() * sizeof(int)));
+        ASSERT_TRUE(ifs.good());
+
+        for (int t = 0; t < threadCount; ++t) {
+            const std::size_t first = blocks[t].offset / sizeof(int);
+            EXPECT_EQ(stored[first], t);
+            EXPECT_EQ(stored[first + size - 1], t);
+            EXPECT_NE(xml.find("Seek=\"" + std::to_string(blocks[t].offset) + "\""), std::string::npos);
+        }
+        EXPECT_EQ(stored[threadCount * size + 1], -2);
+    }
+
+    TEST_F(Test1, AsyncHeavyDataIsWrittenBeforeGenerate) {
+        std::vector<double> values(3000);
+        for (std::size_t i = 0; i < values.size(); ++i) values[i] = static_cast<double>(i);
+
+        // buffered writes, and aligned buffers through O_DIRECT where the file system supports it
+        for (const bool direct_io : {false, true}) {
+            const std::string base_name = direct_io ? "async_direct_heavy_data_test" : "async_heavy_data_test";
+            const std::string heavy_file = base_name + ".bin";
+            addGeneratedFiles({heavy_file, base_name + ".xmf"});
+
+            SimpleXdmf gen;
+            gen.setHeavyDataFile(heavy_file);
+            gen.setAsyncHeavyData(true, 4096, 2, direct_io);
+
+            for (int n = 0; n < 3; ++n) {
+                gen.beginDataItem();
+                    gen.setDimensions(values.size());
+                    gen.setFormat("Binary");
+                    gen.addVector(values);
+                gen.endDataItem();
+
+                // an allocation by another writer moves the following DataItem to an unaligned offset
+                if (n == 0) gen.allocateHeavyData<char>(3);
+            }
+            EXPECT_NE(gen.getAsyncHeavyDataEngine(), "");
+
+            gen.generate(base_name + ".xmf");
+            EXPECT_NE(gen.getRawString().find("Seek=\"24003\""), std::string::npos);
+
+            const std::string bytes = readFile(heavy_file);
+            ASSERT_EQ(bytes.size(), 3 * 24000u + 3u);
+
+            for (const std::size_t offset : {std::size_t(0), std::size_t(24003), std::size_t(48003)}) {
+                std::vector<double> stored(values.size());
+                std::memcpy(stored.data(), bytes.data() + offset, 24000);
+                EXPECT_EQ(stored, values);
+            }
+        }
+    }
+
+#ifdef USE_HDF5
+    TEST_F(Test1, HDFDatasetsAreNamedAfterElements) {
+        const std::string hdf_file = "hdf_backend_test.h5";
+        addGeneratedFiles({hdf_file, "hdf_backend_test.xmf"});
+        std::vector<double> values(20000, 1.5);
+        std::vector<int> small = {1, 2, 3};
+
+        SimpleXdmf gen;
+        gen.setHDFFile(hdf_file);
+        gen.setHDFChunkSize(4096);
+        gen.setHDFCompression(1);
+
+        gen.beginDomain();
+            gen.begin2DStructuredGrid("Grid1", "2DCoRectMesh", 200, 100);
+                gen.beginAttribute("Pressure");
+                    gen.beginDataItem();
+                        gen.setDimensions(200, 100);
+                        gen.setFormat("HDF");
+                        gen.addVector(values);
+                    gen.endDataItem();
+                gen.endAttribute();
+                gen.beginAttribute("Flags");
+                    gen.beginDataItem();
+                        gen.setDimensions(3);
+                        gen.setFormat("HDF");
+                        gen.addVector(small);
+                    gen.endDataItem();
+                    gen.beginDataItem();
+                        gen.setDimensions(3);
+                        gen.setFormat("HDF");
+                        gen.addVector(small);
+                    gen.endDataItem();
+                gen.endAttribute();
+            gen.end2DStructuredGrid();
+        gen.endDomain();
+        gen.generate("hdf_backend_test.xmf");
+
+        const auto xml = gen.getRawString();
+        EXPECT_NE(xml.find("NumberType=\"Float\" Precision=\"8\""), std::string::npos);
+        EXPECT_NE(xml.find("hdf_backend_test.h5:/Domain/Grid1/Pressure/DataItem\n"), std::string::npos);
+        EXPECT_NE(xml.find("hdf_backend_test.h5:/Domain/Grid1/Flags/DataItem_1\n"), std::string::npos);
+
+        const hid_t file = H5Fopen(hdf_file.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+        ASSERT_GE(file, 0);
+
+        const hid_t dataset = H5Dopen2(file, "/Domain/Grid1/Pressure/DataItem", H5P_DEFAULT);
+        ASSERT_GE(dataset, 0);
+        const hid_t space = H5Dget_space(dataset);
+        hsize_t dimensions[2] = {0, 0};
+        EXPECT_EQ(H5Sget_simple_extent_dims(space, dimensions, nullptr), 2);
+        EXPECT_EQ(dimensions[0], 100u);
+        EXPECT_EQ(dimensions[1], 200u);
+
+        std::vector<double> stored(values.size());
+        EXPECT_GE(H5Dread(dataset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, stored.data()), 0);
+        EXPECT_EQ(stored, values);
+        H5Sclose(space);
+        H5Dclose(dataset);
+
+        const hid_t flags = H5Dopen2(file, "/Domain/Grid1/Flags/DataItem_1", H5P_DEFAULT);
+        ASSERT_GE(flags, 0);
+        std::vector<int> stored_flags(3);
+        EXPECT_GE(H5Dread(flags, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, stored_flags.data()), 0);
+        EXPECT_EQ(stored_flags, small);
+        H5Dclose(flags);
+        H5Fclose(file);
+    }
+#endif
+
+    TEST_F(Test1, AMRHierarchyMatchesBlockByBlockOutput) {
+        addGeneratedFiles({"amr_test.bin", "amr_test.xmf", "amr_expected_test.bin"});
+        std::vector<SimpleXdmf::AMRBlock> blocks(3);
+        blocks[0].level = 1;
+        blocks[0].origin = {{0.5, 0.0, 0.0}};
+        blocks[0].spacing = {{0.25, 0.25, 0.25}};
+        blocks[0].extents = {{3, 3, 3}};
+        blocks[1].extents = {{2, 3, 2}};
+        blocks[2].origin = {{1.0, 0.0, 0.0}};
+        blocks[2].extents = {{2, 3, 2}};
+
+        std::vector<std::vector<double>> values = {std::vector<double>(8, 1.0), std::vector<double>(2, 2.0), std::vector<double>(2, 3.0)};
+        SimpleXdmf::AMRField<double> density;
+        density.name = "Density";
+        for (const auto& v : values) density.values.push_back(v.data());
+
+        SimpleXdmf gen;
+        gen.setHeavyDataFile("amr_test.bin");
+        gen.beginDomain();
+            gen.addAMRHierarchy<double>("AMR", blocks, {density}, 2);
+            gen.beginDataItem();
+                gen.setReferenceFromName("Block0");
+            gen.endDataItem();
+        gen.endDomain();
+        gen.generate("amr_test.xmf");
+
+        SimpleXdmf expected;
+        expected.setHeavyDataFile("amr_expected_test.bin");
+        expected.beginDomain();
+            expected.beginGrid("AMR", "Tree");
+            for (const unsigned int level : {0u, 1u}) {
+                expected.beginGrid("Level" + std::to_string(level), "Collection");
+                for (const std::size_t i : {std::size_t(1), std::size_t(2), std::size_t(0)}) {
+                    const auto& b = blocks[i];
+                    if (b.level != level) continue;
+                    expected.begin3DStructuredGrid("Block" + std::to_string(i), "3DCoRectMesh", b.extents[0], b.extents[1], b.extents[2]);
+                        expected.add3DGeometryOrigin("", b.origin[0], b.origin[1], b.origin[2], b.spacing[0], b.spacing[1], b.spacing[2]);
+                        expected.beginAttribute("Density");
+                            expected.setCenter("Cell");
+                            expected.beginDataItem();
+                                expected.setDimensions(b.extents[0] - 1, b.extents[1] - 1, b.extents[2] - 1);
+                                expected.setFormat("Binary");
+                                expected.addVector(values[i]);
+                            expected.endDataItem();
+                        expected.endAttribute();
+                    expected.end3DStructuredGrid();
+                }
+                expected.endGrid();
+            }
+            expected.endGrid();
+            expected.beginDataItem();
+                expected.setReferenceFromName("Block0");
+            expected.endDataItem();
+        expected.endDomain();
+        expected.endXdmf();
+
+        const std::regex file_name("amr_(expected_)?test.bin");
+        EXPECT_EQ(std::regex_replace(gen.getRawString(), file_name, "heavy"), std::regex_replace(expected.getRawString(), file_name, "heavy"));
+
+        // blocks are packed in the order of the document
+        std::ifstream ifs("amr_test.bin", std::ios::binary);
+        std::vector<double> stored(12);
+        ifs.read(reinterpret_cast<char*>(stored.data()), 12 * sizeof(double));
+        EXPECT_EQ(stored[0], 2.0);
+        EXPECT_EQ(stored[3], 3.0);
+        EXPECT_EQ(stored[11], 1.0);
+
+        // settings of the DataItem path are rejected, and so are blocks without values
+        for (int setting = 0; setting < 3; ++setting) {
+            SimpleXdmf rejected;
+            rejected.setHeavyDataFile("amr_test.bin");
+            auto field = density;
+            if (setting == 0) rejected.setHeavyDataEndian("Big");
+            if (setting == 1) rejected.setStatistics();
+            if (setting == 2) field.values[1] = nullptr;
+            EXPECT_ANY_THROW(rejected.addAMRHierarchy<double>("AMR", blocks, {field}));
+        }
+    }
+
+    TEST_F(Test1, ParticleStepsAreAppendedToHeavyData) {
+        const std::string heavy_file = "particle_series_test.bin";
+        addGeneratedFiles({heavy_file, "particle_series_test.xmf"});
+        std::remove(heavy_file.c_str());
+        std::vector<float> positions_0 = {0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f};
+        std::vector<float> positions_1 = {2.0f, 2.0f, 2.0f};
+        std::vector<float> ids_0 = {1.0f, 2.0f};
+        std::vector<float> ids_1 = {2.0f};
+
+        {
+            SimpleXdmf gen;
+            gen.setHeavyDataFile(heavy_file);
+            gen.beginDomain();
+                gen.beginParticleSeries();
+                    gen.addParticleStep(0.0, positions_0, {{"Id", ids_0.data()}});
+                    gen.addParticleStep(0.5, positions_1, {{"Id", ids_1.data()}});
+                gen.endParticleSeries();
+            gen.endDomain();
+            gen.generate("particle_series_test.xmf");
+
+            const auto xml = gen.getRawString();
+            EXPECT_NE(xml.find("CollectionType=\"Temporal\""), std::string::npos);
+            EXPECT_NE(xml.find("<Time TimeType=\"Single\" Value=\"0.5\">"), std::string::npos);
+            EXPECT_NE(xml.find("TopologyType=\"Polyvertex\" NumberOfElements=\"1\""), std::string::npos);
+            EXPECT_NE(xml.find("Dimensions=\"1 3\" Format=\"Binary\" NumberType=\"Float\" Precision=\"4\" Seek=\"32\""), std::string::npos);
+
+            const auto& steps = gen.getParticleSteps();
+            ASSERT_EQ(steps.size(), 2u);
+            EXPECT_EQ(steps[0].begin, 0u);
+            EXPECT_EQ(steps[0].end, 32u);
+            EXPECT_EQ(steps[1].count, 1u);
+            EXPECT_EQ(steps[1].end, 48u);
+        }
+
+        // a restarted run continues the file and the step names
+        SimpleXdmf gen;
+        gen.setHeavyDataFile(heavy_file, true);
+        gen.beginParticleSeries("Particles", 2);
+            gen.addParticleStep(0.1, positions_1);
+        gen.endParticleSeries();
+        EXPECT_EQ(gen.getParticleSteps()[0].begin, 48u);
+        EXPECT_NE(gen.getRawString().find("Name=\"Step2\""), std::string::npos);
+        EXPECT_NE(gen.getRawString().find("<Time TimeType=\"Single\" Value=\"0.1\">"), std::string::npos);
+        gen.generate("particle_series_test.xmf");
+
+        std::ifstream ifs(heavy_file, std::ios::binary | std::ios::ate);
+        EXPECT_EQ(static_cast<std::size_t>(ifs.tellg()), 60u);
+    }
+
+    TEST_F(Test1, SparseAttributeHoldsOnlyActiveCells) {
+        addGeneratedFiles({"sparse_attribute_test.bin", "sparse_attribute_test.xmf"});
+        std::vector<double> depth = {0.0, 1.5, 0.0, 0.0, 2.25, 0.0};
+        std::vector<bool> wet = {false, true, false, false, true, false};
+
+        SimpleXdmf gen;
+        gen.setHeavyDataFile("sparse_attribute_test.bin");
+        gen.beginDomain();
+            gen.addSparseAttribute("Depth", depth, wet);
+            gen.addSparseAttribute("Depth", depth, wet, 1, "Cell", "Binary");
+        gen.endDomain();
+        gen.generate("sparse_attribute_test.xmf");
+
+        const auto xml = gen.getRawString();
+        EXPECT_NE(xml.find("<Set SetType=\"Cell\" Name=\"Depth\">"), std::string::npos);
+        EXPECT_NE(xml.find("NumberType=\"UInt\" Precision=\"4\" Dimensions=\"2\">\n                1 4\n"), std::string::npos);
+        EXPECT_NE(xml.find("NumberType=\"Float\" Precision=\"8\" Dimensions=\"2\">\n                    1.5 2.25\n"), std::string::npos);
+
+        // 2 indices and 2 values in the heavy data file
+        std::ifstream ifs("sparse_attribute_test.bin", std::ios::binary);
+        std::uint32_t indices[2];
+        double values[2];
+        ifs.read(reinterpret_cast<char*>(indices), sizeof(indices));
+        ifs.read(reinterpret_cast<char*>(values), sizeof(values));
+        EXPECT_EQ(indices[0], 1u);
+        EXPECT_EQ(indices[1], 4u);
+        EXPECT_EQ(values[1], 2.25);
+        EXPECT_EQ(ifs.peek(), std::char_traits<char>::eof());
+    }
+
+    TEST_F(Test1, PreviewLevelsAverageBlocks) {
+        const std::size_t nx = 5, ny = 3, nz = 9;
+        std::vector<float> node_values(nx * ny * nz);
+        std::vector<float> cell_values((nx - 1) * (ny - 1) * (nz - 1));
+        for(std::size_t i = 0; i < node_values.size(); ++i) node_values[i] = static_cast<float>(i % nx);
+        for(std::size_t i = 0; i < cell_values.size(); ++i) cell_values[i] = static_cast<float>(i);
+
+        std::vector<SimpleXdmf::PreviewField<float>> fields(2);
+        fields[0].name = "Node";
+        fields[0].values = node_values.data();
+        fields[1].name = "Cell";
+        fields[1].values = cell_values.data();
+        fields[1].center = "Cell";
+
+        SimpleXdmf gen;
+        gen.beginDomain();
+            gen.add3DPreviewLevels("Grid", nx, ny, nz, 0.0, 0.0, 0.0, 0.1, 0.2, 0.3, fields, "XML", 3, 2);
+        gen.endDomain();
+
+        const auto xml = gen.getRawString();
+        EXPECT_NE(xml.find("Name=\"Grid_x2\""), std::string::npos);
+        EXPECT_NE(xml.find("NumberOfElements=\"5 2 3\""), std::string::npos);
+        EXPECT_NE(xml.find("0.6 0.4 0.2"), std::string::npos);
+        // ny = 2 cannot be halved any more
+        EXPECT_EQ(xml.find("Name=\"Grid_x4\""), std::string::npos);
+
+        // points average their neighbours, and cells average 2 x 2 x 2 cells
+        EXPECT_NE(xml.find("0.5 2 3.5 0.5 2 3.5"), std::string::npos);
+        EXPECT_NE(xml.find("6.5 8.5 22.5 24.5 38.5 40.5 54.5 56.5"), std::string::npos);
+
+        // an even number of points pads the coarse grid, and the last box holds the remaining values
+        std::vector<float> even_nodes(4 * 3);
+        std::vector<float> even_cells(3 * 2);
+        for(std::size_t i = 0; i < even_nodes.size(); ++i) even_nodes[i] = static_cast<float>(i % 4);
+        for(std::size_t i = 0; i < even_cells.size(); ++i) even_cells[i] = static_cast<float>(i);
+        fields[0].values = even_nodes.data();
+        fields[1].values = even_cells.data();
+
+        SimpleXdmf even;
+        even.beginDomain();
+            even.add2DPreviewLevels("Grid", 4, 3, 0.0, 0.0, 0.1, 0.2, fields, "XML", 1);
+        even.endDomain();
+
+        const auto even_xml = even.getRawString();
+        EXPECT_NE(even_xml.find("NumberOfElements=\"2 3\""), std::string::npos);
+        EXPECT_NE(even_xml.find("0.5 2 3 0.5 2 3"), std::string::npos);
+        EXPECT_NE(even_xml.find("2 3.5"), std::string::npos);
+
+        // the format does not follow the heavy data file
+        SimpleXdmf binary;
+        binary.setHeavyDataFile("/dev/null");
+        binary.beginDomain();
+            binary.add2DPreviewLevels("Grid", 4, 3, 0.0, 0.0, 0.1, 0.2, fields, "Binary", 1);
+            binary.add2DPreviewLevels("Inline", 4, 3, 0.0, 0.0, 0.1, 0.2, fields, "XML", 1);
+        binary.endDomain();
+
+        const auto binary_xml = binary.getRawString();
+        EXPECT_NE(binary_xml.find("Format=\"Binary\" NumberType=\"Float\" Precision=\"4\" Seek=\"0\""), std::string::npos);
+        EXPECT_NE(binary_xml.find("Name=\"Inline_x2\""), std::string::npos);
+        EXPECT_EQ(binary_xml.find("Seek=\"", binary_xml.find("Name=\"Inline_x2\"")), std::string::npos);
+
+        // an exception of a worker is rethrown by the calling thread
+        std::vector<SimpleXdmf::AMRBlock> blocks(4);
+        SimpleXdmf::AMRField<float> unwritable;
+        unwritable.name = "Unwritable";
+        unwritable.values.assign(blocks.size(), cell_values.data());
+        SimpleXdmf amr;
+        amr.setHeavyDataFile("no_such_directory/amr_test.bin");
+        EXPECT_ANY_THROW(amr.addAMRHierarchy<float>("AMR", blocks, {unwritable}, 4));
+    }
+
+    TEST_F(Test1, DryRunPlansTheOutput) {
+        const std::string heavy_file = "dry_run_test.bin";
+        addGeneratedFiles({heavy_file, "dry_run_test.xmf"});
+        std::remove(heavy_file.c_str());
+
+        std::vector<double> values(1000);
+        for(std::size_t i = 0; i < values.size(); ++i) values[i] = 0.001 * static_cast<double>(i);
+        std::vector<int> ids = {1, -20, 300};
+
+        SimpleXdmf gen;
+        gen.setHeavyDataFile(heavy_file);
+        auto build = [&](const bool with_text) {
+            gen.beginDomain();
+                gen.beginGrid("Grid");
+                    gen.beginAttribute("Values");
+                        gen.beginDataItem();
+                            gen.setDimensions(values.size());
+                            gen.setFormat("Binary");
+                            gen.addVector(values);
+                        gen.endDataItem();
+                    gen.endAttribute();
+                    if (with_text) {
+                        gen.beginAttribute("Ids");
+                            gen.beginDataItem();
+                                gen.setDimensions(ids.size());
+                                gen.addVector(ids);
+                            gen.endDataItem();
+                        gen.endAttribute();
+                    }
+                gen.endGrid();
+            gen.endDomain();
+        };
+
+        gen.beginDryRun();
+        build(false);
+        const auto plan = gen.endDryRun();
+        EXPECT_FALSE(std::ifstream(heavy_file).is_open());
+        EXPECT_TRUE(plan.isExact);
+        EXPECT_EQ(plan.heavyDataBytes, values.size() * sizeof(double));
+        EXPECT_EQ(plan.dataItemCount, 1u);
+
+        gen.applyOutputPlan(plan);
+        build(false);
+        gen.generate("dry_run_test.xmf");
+        EXPECT_EQ(gen.getRawString().size(), plan.documentBytes);
+        std::ifstream ifs(heavy_file, std::ios::binary | std::ios::ate);
+        EXPECT_EQ(static_cast<std::uint64_t>(ifs.tellg()), plan.heavyDataBytes);
+
+        // text values are bounded from above
+        gen.setHeavyDataFile(heavy_file);
+        gen.beginDryRun();
+        build(true);
+        const auto text_plan = gen.endDryRun();
+        EXPECT_FALSE(text_plan.isExact);
+
+        build(true);
+        gen.generate("dry_run_test.xmf");
+        EXPECT_GE(text_plan.documentBytes, gen.getRawString().size());
+        EXPECT_LE(text_plan.documentBytes, gen.getRawString().size() + 64);
+
+#ifdef USE_HDF5
+        // dataset names continue after the datasets of the previous document in both passes
+        const std::string hdf_file = "dry_run_test.h5";
+        addGeneratedFiles({hdf_file, "dry_run_hdf_test.xmf"});
+        std::remove(hdf_file.c_str());
+
+        SimpleXdmf hdf;
+        hdf.setHDFFile(hdf_file);
+        auto build_hdf = [&]() {
+            hdf.beginDomain();
+                hdf.beginAttribute("Values");
+                    hdf.beginDataItem();
+                        hdf.setDimensions(values.size());
+                        hdf.setFormat("HDF");
+                        hdf.addVector(values);
+                    hdf.endDataItem();
+                hdf.endAttribute();
+            hdf.endDomain();
+        };
+        build_hdf();
+        hdf.generate("dry_run_hdf_test.xmf");
+
+        hdf.beginDryRun();
+        build_hdf();
+        const auto hdf_plan = hdf.endDryRun();
+        EXPECT_TRUE(hdf_plan.isExact);
+
+        build_hdf();
+        hdf.generate("dry_run_hdf_test.xmf");
+        EXPECT_NE(hdf.getRawString().find("dry_run_test.h5:/Domain/Values/DataItem_1\n"), std::string::npos);
+        EXPECT_EQ(hdf.getRawString().size(), hdf_plan.documentBytes);
+#endif
+    }
+
+    TEST_F(Test1, DeferredValuesMatchImmediateOutput) {
+        addGeneratedFiles({"deferred_values_test_a.bin", "deferred_values_test_a.xmf", "deferred_values_test_b.bin", "deferred_values_test_b.xmf",
+                           "deferred_values_test_c.bin", "deferred_values_test_c.xmf"});
+
+        std::vector<std::vector<double>> fields(8, std::vector<double>(150001));
+        for(std::size_t f = 0; f < fields.size(); ++f) {
+            for(std::size_t i = 0; i < fields[f].size(); ++i) fields[f][i] = 0.25 * static_cast<double>(f * i % 977);
+        }
+        std::vector<int> ids = {1, 2, 3};
+
+        auto build = [&](SimpleXdmf& gen, const std::string& heavy_file, const bool map = false) {
+            gen.setHeavyDataFile(heavy_file);
+            gen.beginDomain();
+                gen.beginGrid("Grid");
+                for(std::size_t f = 0; f < fields.size(); ++f) {
+                    gen.beginAttribute("Field" + std::to_string(f));
+                        gen.beginDataItem();
+                            gen.setDimensions(fields[f].size());
+                            if (f % 2 == 1) gen.setFormat("Binary");
+                            gen.addVector(fields[f]);
+                        gen.endDataItem();
+                    gen.endAttribute();
+                }
+                    // pending values are committed before the heavy data file is mapped
+                    if (map) gen.mapHeavyData();
+                    gen.beginAttribute("Ids");
+                        gen.beginDataItem();
+                            gen.setDimensions(ids.size());
+                            gen.addVector(ids);
+                        gen.endDataItem();
+                    gen.endAttribute();
+                gen.endGrid();
+            gen.endDomain();
+        };
+
+        SimpleXdmf immediate;
+        build(immediate, "deferred_values_test_a.bin");
+        immediate.generate("deferred_values_test_a.xmf");
+
+        SimpleXdmf deferred;
+        deferred.setDeferredValues(true, 4);
+        build(deferred, "deferred_values_test_b.bin");
+        deferred.generate("deferred_values_test_b.xmf");
+
+        // the documents differ only in the name of the heavy data file
+        const std::string expected = std::regex_replace(immediate.getRawString(), std::regex("test_a\\.bin"), "test_b.bin");
+        EXPECT_EQ(deferred.getRawString().size(), expected.size());
+        EXPECT_TRUE(deferred.getRawString() == expected);
+        EXPECT_TRUE(readFile("deferred_values_test_b.bin") == readFile("deferred_values_test_a.bin"));
+
+        SimpleXdmf mapped;
+        mapped.setDeferredValues(true, 4);
+        build(mapped, "deferred_values_test_c.bin", true);
+        mapped.generate("deferred_values_test_c.xmf");
+
+        EXPECT_TRUE(mapped.getRawString() == std::regex_replace(immediate.getRawString(), std::regex("test_a\\.bin"), "test_c.bin"));
+        EXPECT_TRUE(readFile("deferred_values_test_c.bin") == readFile("deferred_values_test_a.bin"));
+    }
+
+    TEST_F(Test1, InMemorySinksHoldTheSnapshot) {
+        std::vector<float> values = {1.0f, 2.0f, 3.0f, 4.0f};
+        auto build = [&](SimpleXdmf& gen) {
+            gen.beginDomain();
+                gen.beginGrid("Grid");
+                    gen.beginAttribute("Values");
+                        gen.beginDataItem();
+                            gen.setDimensions(values.size());
+                            gen.setFormat("Binary");
+                            gen.addVector(values);
+                        gen.endDataItem();
+                    gen.endAttribute();
+                gen.endGrid();
+            gen.endDomain();
+        };
+
+        // caller buffers
+        std::vector<char> heavy_data(64);
+        std::vector<char> document(4096);
+        SimpleXdmf gen;
+        gen.setHeavyDataBuffer(heavy_data.data(), heavy_data.size(), "snapshot");
+        build(gen);
+        const std::size_t size = gen.generateToBuffer(document.data(), document.size());
+        EXPECT_EQ(gen.getHeavyDataSize(), values.size() * sizeof(float));
+        EXPECT_EQ(std::memcmp(heavy_data.data(), values.data(), values.size() * sizeof(float)), 0);
+        EXPECT_EQ(std::string(document.data(), size), gen.getContent());
+        EXPECT_NE(gen.getContent().find("Seek=\"0\""), std::string::npos);
+        EXPECT_NE(gen.getContent().find("snapshot"), std::string::npos);
+
+        const std::string released = gen.releaseContent();
+        EXPECT_EQ(released, std::string(document.data(), size));
+        EXPECT_TRUE(gen.getContent().empty());
+
+#ifdef SIMPLE_XDMF_POSIX
+        // shared memory
+        const std::string name = "/simple_xdmf_test_" + std::to_string(::getpid());
+        SimpleXdmf shared;
+        shared.setSharedMemoryOutput(name, 1 << 20);
+        build(shared);
+        shared.generateSharedMemory();
+
+        const int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+        ASSERT_GE(fd, 0);
+        SimpleXdmf::SharedMemoryHeader header;
+        ASSERT_EQ(::pread(fd, &header, sizeof(header), 0), static_cast<ssize_t>(sizeof(header)));
+        EXPECT_EQ(std::string(header.magic), "SXDMF01");
+        EXPECT_EQ(header.heavyDataSize, values.size() * sizeof(float));
+
+        const std::size_t total = static_cast<std::size_t>(header.xmlOffset + header.xmlSize);
+        const char* snapshot = static_cast<const char*>(::mmap(nullptr, total, PROT_READ, MAP_SHARED, fd, 0));
+        EXPECT_EQ(std::memcmp(snapshot + header.heavyDataOffset, values.data(), header.heavyDataSize), 0);
+        EXPECT_EQ(std::string(snapshot + header.xmlOffset, header.xmlSize), shared.getContent());
+
+        // the next snapshot is a new object, so the mapping of the previous one stays readable
+        values.assign(values.size(), 5.0f);
+        SimpleXdmf next;
+        next.setSharedMemoryOutput(name, 1 << 20);
+        build(next);
+        next.generateSharedMemory();
+        EXPECT_EQ(std::string(snapshot + header.xmlOffset, header.xmlSize), shared.getContent());
+        EXPECT_EQ(reinterpret_cast<const float*>(snapshot + header.heavyDataOffset)[0], 1.0f);
+
+        ::munmap(const_cast<char*>(snapshot), total);
+        ::close(fd);
+        ::shm_unlink(name.c_str());
+#endif
+    }
+
+    TEST_F(Test1, StagedFilesAreDrainedToDestinations) {
+        addGeneratedFiles({"staging_test.bin", "staging_test.xmf", "staging_test_next.xmf"});
+
+        std::vector<float> values = {1.0f, 2.0f, 3.0f};
+
+        SimpleXdmf gen;
+        gen.setStagingDirectory(".", 1);
+        gen.setHeavyDataFile("staging_test.bin");
+        gen.beginDomain();
+            gen.beginAttribute("Values");
+                gen.beginDataItem();
+                    gen.setDimensions(values.size());
+                    gen.setFormat("Binary");
+                    gen.addVector(values);
+                gen.endDataItem();
+            gen.endAttribute();
+        gen.endDomain();
+        gen.generate("staging_test.xmf");
+        gen.waitForDrain();
+
+        const auto status = gen.getDrainStatus();
+        EXPECT_EQ(status.pendingFiles, 0u);
+        EXPECT_EQ(status.drainedFiles, 2u);
+        EXPECT_EQ(status.failedFiles, 0u);
+
+        // the document refers to the destination, and the staged files are removed
+        EXPECT_NE(gen.getContent().find("staging_test.bin"), std::string::npos);
+        EXPECT_EQ(gen.getContent().find("_staging_test.bin"), std::string::npos);
+#ifdef SIMPLE_XDMF_POSIX
+        DIR* directory = ::opendir(".");
+        ASSERT_NE(directory, nullptr);
+        for (const dirent* entry = ::readdir(directory); entry != nullptr; entry = ::readdir(directory)) {
+            const std::string entry_name = entry->d_name;
+            EXPECT_EQ(entry_name.find("_staging_test."), std::string::npos) << entry_name;
+            EXPECT_EQ(entry_name.find("staging_test.xmf."), std::string::npos) << entry_name;
+        }
+        ::closedir(directory);
+#endif
+
+        EXPECT_EQ(readFile("staging_test.xmf"), gen.getContent());
+
+        std::ifstream heavy_data("staging_test.bin", std::ios::binary | std::ios::ate);
+        EXPECT_EQ(static_cast<std::size_t>(heavy_data.tellg()), values.size() * sizeof(float));
+        heavy_data.close();
+
+        // the next document stages the heavy data file again for the same destination
+        std::vector<float> next_values = {4.0f, 5.0f};
+        gen.reset();
+        gen.beginDomain();
+            gen.beginAttribute("Values");
+                gen.beginDataItem();
+                    gen.setDimensions(next_values.size());
+                    gen.setFormat("Binary");
+                    gen.addVector(next_values);
+                gen.endDataItem();
+            gen.endAttribute();
+        gen.endDomain();
+        gen.generate("staging_test_next.xmf");
+        gen.waitForDrain();
+
+        EXPECT_EQ(gen.getDrainStatus().drainedFiles, 4u);
+        EXPECT_NE(gen.getContent().find("Seek=\"0\""), std::string::npos);
+        const std::string next_heavy_data = readFile("staging_test.bin");
+        ASSERT_EQ(next_heavy_data.size(), next_values.size() * sizeof(float));
+        EXPECT_EQ(std::memcmp(next_heavy_data.data(), next_values.data(), next_heavy_data.size()), 0);
+    }
+
+    TEST_F(Test1, TemporalIndexLocatesAndContinuesSteps) {
+        addGeneratedFiles({"temporal_index_test.xmf", "temporal_index_test.xmf.idx", "temporal_index_full.xmf", "temporal_index_full.xmf.idx"});
+
+        auto add_step = [](SimpleXdmf& gen, const int step) {
+            gen.beginGrid("Step" + std::to_string(step));
+                gen.beginTime();
+                    gen.setValue(std::to_string(step * 0.5));
+                gen.endTime();
+                gen.beginAttribute("Values");
+                    gen.beginDataItem();
+                        gen.setDimensions(2);
+                        gen.addVector(std::vector<int>{step, step + 1});
+                    gen.endDataItem();
+                gen.endAttribute();
+            gen.endGrid();
+        };
+
+        auto generate = [&](const std::string& file_name, const int steps) {
+            SimpleXdmf gen;
+            gen.setTemporalIndex();
+            gen.beginDomain();
+                gen.beginGrid("Series", "Collection");
+                    gen.setCollectionType("Temporal");
+                    for(int step = 0; step < steps; ++step) add_step(gen, step);
+                gen.endGrid();
+            gen.endDomain();
+            gen.generate(file_name);
+        };
+
+        generate("temporal_index_test.xmf", 3);
+        generate("temporal_index_full.xmf", 4);
+
+        const std::string document = readFile("temporal_index_test.xmf");
+        ASSERT_EQ(SimpleXdmf::getTemporalStepCount("temporal_index_test.xmf"), 3u);
+        for(std::size_t step = 0; step < 3; ++step) {
+            const auto found = SimpleXdmf::readTemporalStep("temporal_index_test.xmf", step);
+            const std::string grid = "<Grid GridType=\"Uniform\" Name=\"Step" + std::to_string(step) + "\"";
+            EXPECT_EQ(document[found.offset - 1], '\n');
+            EXPECT_EQ(document.compare(document.find_first_not_of(' ', found.offset), grid.size(), grid), 0);
+            EXPECT_EQ(found.time, std::to_string(step * 0.5));
+        }
+        EXPECT_THROW(SimpleXdmf::readTemporalStep("temporal_index_test.xmf", 3), std::out_of_range);
+
+        // continuing the file gives the same document and index as generating all steps at once
+        SimpleXdmf gen;
+        gen.continueTemporalFile("temporal_index_test.xmf");
+                    add_step(gen, 3);
+                gen.endGrid();
+            gen.endDomain();
+        gen.generate("temporal_index_test.xmf");
+
+        const std::string full = readFile("temporal_index_full.xmf");
+        const std::string continued = readFile("temporal_index_test.xmf");
+        EXPECT_EQ(std::regex_replace(continued, std::regex("temporal_index_test"), "temporal_index_full"), full);
+        EXPECT_EQ(readFile("temporal_index_test.xmf.idx"), readFile("temporal_index_full.xmf.idx"));
+
+        // a Time value wider than its record is rejected
+        SimpleXdmf wide;
+        wide.setTemporalIndex();
+        wide.beginDomain();
+            wide.beginGrid("Series", "Collection");
+                wide.setCollectionType("Temporal");
+                wide.beginGrid("Step0");
+                    wide.beginTime();
+                        EXPECT_THROW(wide.setValue(std::string(43, '1')), std::length_error);
+                        wide.setValue(std::string(42, '1'));
+                    wide.endTime();
+                wide.endGrid();
+            wide.endGrid();
+        wide.endDomain();
+
+        // a collection path wider than the header is rejected instead of truncated
+        addGeneratedFiles({"temporal_index_deep.xmf", "temporal_index_deep.xmf.idx"});
+        SimpleXdmf deep;
+        deep.setTemporalIndex();
+        deep.beginDomain();
+            for(int level = 0; level < 13; ++level) deep.beginGrid("Level" + std::to_string(level), "Collection");
+            deep.setCollectionType("Temporal");
+            add_step(deep, 0);
+            for(int level = 0; level < 13; ++level) deep.endGrid();
+        deep.endDomain();
+        EXPECT_THROW(deep.generate("temporal_index_deep.xmf"), std::length_error);
+        EXPECT_FALSE(std::ifstream("temporal_index_deep.xmf.idx").is_open());
+    }
+
+    TEST_F(Test1, BatchedAttributesMatchSeparateAttributes) {
+        addGeneratedFiles({"batched_a.bin", "batched_a.xmf", "batched_b.bin", "batched_b.xmf"});
+
+        struct Cell {
+            double depth;
+            double velocity[3];
+            double bed;
+        };
+
+        // several blocks of items
+        const std::size_t size = 20000;
+        std::vector<Cell> cells(size);
+        std::vector<double> depth(size), velocity(size * 3), roughness(size);
+        for(std::size_t i = 0; i < size; ++i) {
+            cells[i] = Cell{0.5 * i, {1.0 * i, 2.0 * i, 3.0 * i}, -0.25 * i};
+            depth[i] = cells[i].depth;
+            std::copy(cells[i].velocity, cells[i].velocity + 3, velocity.begin() + i * 3);
+            roughness[i] = 0.01 * i;
+        }
+
+        std::vector<SimpleXdmf::AttributeField<double>> fields(3);
+        fields[0].name = "Depth";
+        fields[0].values = &cells[0].depth;
+        fields[0].stride = sizeof(Cell);
+        fields[1].name = "Velocity";
+        fields[1].values = cells[0].velocity;
+        fields[1].components = 3;
+        fields[1].stride = sizeof(Cell);
+        fields[2].name = "Roughness";
+        fields[2].values = roughness.data();
+
+        for(const std::string format : {"XML", "Binary"}) {
+            SimpleXdmf batched;
+            if (format == "Binary") batched.setHeavyDataFile("batched_a.bin");
+            batched.beginDomain();
+                batched.beginGrid("Grid");
+                    batched.addAttributes(fields, size, "Cell", format);
+                batched.endGrid();
+            batched.endDomain();
+            batched.generate("batched_a.xmf");
+
+            SimpleXdmf separate;
+            if (format == "Binary") separate.setHeavyDataFile("batched_b.bin");
+            separate.beginDomain();
+                separate.beginGrid("Grid");
+                    for(const auto& field : {std::make_pair("Depth", &depth), std::make_pair("Velocity", &velocity), std::make_pair("Roughness", &roughness)}) {
+                        const std::size_t components = field.second->size() / size;
+                        separate.beginAttribute(field.first, components == 3 ? "Vector" : "Scalar");
+                            separate.setCenter("Cell");
+                            separate.beginDataItem();
+                                if (components == 1) {
+                                    separate.setDimensions(size);
+                                } else {
+                                    separate.setDimensions(components, size);
+                                }
+                                separate.setFormat(format);
+                                if (format == "XML") {
+                                    separate.setNumberType("Float");
+                                    separate.setPrecision("8");
+                                }
+                                separate.addVector(*field.second);
+                            separate.endDataItem();
+                        separate.endAttribute();
+                    }
+                separate.endGrid();
+            separate.endDomain();
+            separate.generate("batched_b.xmf");
+
+            EXPECT_EQ(std::regex_replace(batched.getContent(), std::regex("batched_a"), "batched_b"), separate.getContent());
+
+            if (format == "Binary") {
+                EXPECT_EQ(readFile("batched_a.bin").size(), size * 5 * sizeof(double));
+                EXPECT_EQ(readFile("batched_a.bin"), readFile("batched_b.bin"));
+            }
+        }
+
+        // statistics of the strided values, for XML and Binary output
+        for(const bool is_binary : {false, true}) {
+            SimpleXdmf stats;
+            if (is_binary) stats.setHeavyDataFile("batched_a.bin");
+            stats.setStatistics();
+            stats.beginDomain();
+                stats.beginGrid("Grid");
+                    stats.addAttributes(fields, size, "Cell", is_binary ? "Binary" : "XML");
+                stats.endGrid();
+            stats.endDomain();
+
+            const auto& last = stats.getLastStatistics();
+            EXPECT_EQ(last.count, size);
+            EXPECT_DOUBLE_EQ(last.max, 0.01 * (size - 1));
+            EXPECT_NE(stats.getRawString().find("<Information Name=\"Max\" Value=\"9999.5\""), std::string::npos);
+            EXPECT_NE(stats.getRawString().find("<Information Name=\"Max\" Value=\"59997\""), std::string::npos);
+        }
+
+        // the format does not follow the heavy data file, and conversions are rejected up front
+        SimpleXdmf inline_values;
+        inline_values.setHeavyDataFile("batched_a.bin");
+        inline_values.beginGrid("Grid");
+            inline_values.addAttributes(fields, 2);
+            const std::uint16_t probe = 1;
+            inline_values.setHeavyDataEndian(*reinterpret_cast<const unsigned char*>(&probe) == 1 ? "Big" : "Little");
+            EXPECT_THROW(inline_values.addAttributes(fields, 2, "Cell", "Binary"), std::invalid_argument);
+            EXPECT_THROW(inline_values.addAttributes(fields, 2, "Cell", "HDF"), std::invalid_argument);
+        inline_values.endGrid();
+        EXPECT_EQ(inline_values.getRawString().find("Binary"), std::string::npos);
+        EXPECT_EQ(inline_values.getRawString().find("Depth", inline_values.getRawString().find("Depth") + 1), std::string::npos);
+
+        fields[1].stride = sizeof(double);
+        SimpleXdmf gen;
+        EXPECT_THROW(gen.addAttributes(fields, size), std::invalid_argument);
+    }
+
+    TEST_F(Test1, NamesAfterOneLineElementsAreReferredByTheirPath) {
+        SimpleXdmf gen;
+        gen.setPositionalXpath();
+
+        gen.beginDomain();
+            gen.begin2DStructuredGrid("Grid1", "2DCoRectMesh", 2, 2);
+                gen.add2DGeometryOrigin("Geometry1", 0.0, 0.0, 1.0, 1.0);
+                gen.beginAttribute("Attr1");
+                gen.endAttribute();
+                gen.beginAttribute("Attr1");
+                gen.endAttribute();
+            gen.end2DStructuredGrid();
+
+            gen.beginGrid("Grid2");
+                gen.setReferenceFromName("Attr1", 1);
+            gen.endGrid();
+            gen.beginGrid("Grid3");
+                gen.setReferenceFromName("Geometry1");
+            gen.endGrid();
+        gen.endDomain();
+
+        const auto xml = gen.getRawString();
+        EXPECT_NE(xml.find("Name=\"Grid2\" Reference=\"(/Xdmf/Domain/Grid/Attribute[@Name='Attr1'])[2]\""), std::string::npos);
+        EXPECT_NE(xml.find("Name=\"Grid3\" Reference=\"/Xdmf/Domain/Grid/Geometry[@Name='Geometry1']\""), std::string::npos);
+    }
+
+    TEST_F(Test1, ResetStartsAFreshDocument) {
+        std::vector<double> values = {1.0, 2.0, 3.0};
+        auto build = [&](SimpleXdmf& gen, const std::string& format) {
+            gen.beginDomain();
+                gen.beginGrid("Grid");
+                    gen.beginAttribute("Values");
+                        gen.beginDataItem();
+                            gen.setDimensions(values.size());
+                            gen.setFormat(format);
+                            gen.addVector(values);
+                        gen.endDataItem();
+                    gen.endAttribute();
+                gen.endGrid();
+            gen.endDomain();
+        };
+
+        SimpleXdmf gen;
+        gen.setStatistics();
+        build(gen, "XML");
+        EXPECT_EQ(gen.getLastStatistics().count, values.size());
+
+        gen.reset();
+        EXPECT_EQ(gen.getLastStatistics().count, 0u);
+        EXPECT_EQ(gen.getLastStatistics().name, "");
+
+#ifdef USE_HDF5
+        // datasets of the previous document in the same file keep their names
+        addGeneratedFiles({"reset_test.h5", "reset_test.xmf"});
+        std::remove("reset_test.h5");
+
+        SimpleXdmf hdf;
+        hdf.setHDFFile("reset_test.h5");
+        build(hdf, "HDF");
+        hdf.generate("reset_test.xmf");
+        EXPECT_NE(hdf.getRawString().find("reset_test.h5:/Domain/Grid/Values/DataItem\n"), std::string::npos);
+
+        hdf.reset();
+        build(hdf, "HDF");
+        hdf.generate("reset_test.xmf");
+        EXPECT_NE(hdf.getRawString().find("reset_test.h5:/Domain/Grid/Values/DataItem_1\n"), std::string::npos);
+#endif
+    }
+
+    TEST_F(Test1, TransposedArraysAreQuantizedAndNarrowed) {
+        std::int64_t int_values[2][3] = {{1, 2, 3}, {4, 5, 200}};
+        std::int64_t* int_rows[2] = {int_values[0], int_values[1]};
+        const std::vector<std::int64_t> int_xdmf = {1, 4, 2, 5, 3, 200};
+        float float_values[2][3] = {{0.0f, 0.5f, 1.0f}, {0.25f, 0.75f, -1.0f}};
+        float* float_rows[2] = {float_values[0], float_values[1]};
+        const std::vector<float> float_xdmf = {0.0f, 0.25f, 0.5f, 0.75f, 1.0f, -1.0f};
+
+        auto build = [&](SimpleXdmf& gen, char* heavy_data, const bool transposed) {
+            gen.setHeavyDataBuffer(heavy_data, 64, "memory");
+            gen.setIntegerNarrowing();
+            gen.setDeferredValues(true, 2);
+            gen.beginDomain();
+                gen.beginAttribute("Ids");
+                    gen.beginDataItem();
+                        gen.setDimensions(2, 3);
+                        gen.setFormat("Binary");
+                        if (transposed) {
+                            gen.add2DArray(int_rows, 2, 3);
+                        } else {
+                            gen.addVector(int_xdmf);
+                        }
+                    gen.endDataItem();
+                gen.endAttribute();
+                gen.beginAttribute("Values");
+                    gen.beginDataItem();
+                        gen.setDimensions(2, 3);
+                        gen.setQuantization(8);
+                        if (transposed) {
+                            gen.add2DArray(float_rows, 2, 3);
+                        } else {
+                            gen.addVector(float_xdmf);
+                        }
+                    gen.endDataItem();
+                gen.endAttribute();
+            gen.endDomain();
+        };
+
+        char transposed_data[64] = {};
+        char contiguous_data[64] = {};
+        SimpleXdmf transposed;
+        SimpleXdmf contiguous;
+        build(transposed, transposed_data, true);
+        build(contiguous, contiguous_data, false);
+
+        EXPECT_EQ(transposed.getRawString(), contiguous.getRawString());
+        EXPECT_NE(transposed.getRawString().find("NumberType=\"UChar\" Precision=\"1\" Seek=\"0\""), std::string::npos);
+        EXPECT_NE(transposed.getRawString().find("ItemType=\"Function\""), std::string::npos);
+        EXPECT_EQ(std::memcmp(transposed_data, contiguous_data, sizeof(transposed_data)), 0);
+    }
+
+    TEST_F(Test1, GeneratedValuesAreCheckedBeforeTheyAreWritten) {
+        const std::string heavy_data_file = "generated_values_test.bin";
+        addGeneratedFiles({heavy_data_file, "generated_values_test.xmf"});
+
+        SimpleXdmf gen;
+        gen.setHeavyDataFile(heavy_data_file);
+
+        gen.beginDataItem();
+            gen.setDimensions(100000);
+            gen.setFormat("Binary");
+            gen.setStoredPrecision("2");
+            // the overflowing value is in the second chunk
+            EXPECT_THROW(gen.addGeneratedValues<std::int32_t>(100000, [](std::int32_t* chunk, std::size_t offset, std::size_t count) {
+                for(std::size_t i = 0; i < count; ++i) chunk[i] = (offset + i == 99999) ? 70000 : static_cast<std::int32_t>((offset + i) % 1000);
+            }), std::overflow_error);
+        gen.endDataItem();
+
+        gen.beginDataItem();
+            gen.setDimensions(4);
+            gen.setFormat("Binary");
+            gen.setQuantization(8);
+            EXPECT_THROW(gen.addGeneratedValues<float>(4, [](float* chunk, std::size_t, std::size_t count) {
+                std::fill(chunk, chunk + count, 1.0f);
+            }), std::invalid_argument);
+        gen.endDataItem();
+
+        gen.setIntegerNarrowing();
+        gen.beginDataItem();
+            gen.setDimensions(4);
+            gen.setFormat("Binary");
+            EXPECT_THROW(gen.addGeneratedValues<std::int64_t>(4, [](std::int64_t* chunk, std::size_t, std::size_t count) {
+                std::fill(chunk, chunk + count, 1);
+            }), std::invalid_argument);
+        gen.endDataItem();
+        gen.setIntegerNarrowing(false);
+
+        gen.beginDataItem();
+            gen.setDimensions(100000);
+            gen.setFormat("Binary");
+            gen.setStoredPrecision("2");
+            gen.addGeneratedValues<std::int32_t>(100000, [](std::int32_t* chunk, std::size_t offset, std::size_t count) {
+                for(std::size_t i = 0; i < count; ++i) chunk[i] = static_cast<std::int32_t>((offset + i) % 1000);
+            });
+        gen.endDataItem();
+        gen.generate("generated_values_test.xmf");
+
+        const auto xml = gen.getRawString();
+        EXPECT_NE(xml.find("NumberType=\"Int\" Precision=\"2\" Seek=\"0\""), std::string::npos);
+        EXPECT_EQ(xml.find("Seek=\"200000\""), std::string::npos);
+        std::ifstream heavy_data(heavy_data_file, std::ios::binary | std::ios::ate);
+        EXPECT_EQ(static_cast<std::size_t>(heavy_data.tellg()), 200000u);
+    }
+}
@@ -4,12 +4,26 @@
 #include <simple_xdmf.hpp>
 #include <gtest/gtest.h>
 
+#include <initializer_list>
+#include <string>
+#include <vector>
+
 namespace TEST_SIMPLE_XDMF {
     class Test1 : public ::testing::Test {
         protected:
             Test1();
             ~Test1();
+
+            // whole content of a file, empty if it cannot be read
+            static std::string readFile(const std::string& file_name);
+
+            // files written by the test, removed by TearDown()
+            void addGeneratedFiles(std::initializer_list<std::string> file_names);
+            void TearDown() override;
+
+        private:
+            std::vector<std::string> generatedFiles;
     };
 }
 
-#endif
\ No newline at end of file
+#endif
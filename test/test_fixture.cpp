@@ -1,5 +1,9 @@
 #include <test_simple_xdmf.hpp>
 
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
 namespace TEST_SIMPLE_XDMF {
 
     Test1::Test1() {
@@ -7,4 +11,18 @@ namespace TEST_SIMPLE_XDMF {
 
     Test1::~Test1() {
     }
-}
\ No newline at end of file
+
+    std::string Test1::readFile(const std::string& file_name) {
+        std::ifstream ifs(file_name, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    }
+
+    void Test1::addGeneratedFiles(std::initializer_list<std::string> file_names) {
+        generatedFiles.insert(generatedFiles.end(), file_names);
+    }
+
+    void Test1::TearDown() {
+        for (const auto& file_name : generatedFiles) std::remove(file_name.c_str());
+        generatedFiles.clear();
+    }
+}